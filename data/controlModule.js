@@ -1,66 +1,83 @@
 // controlModule.js - Control panel functionality
 
 const controlModule = {
+    // DAC request coalescing: at most one /dac request in flight, newest value wins
+    dacRequestInFlight: false,
+    pendingDACValue: null,
+    // Measured code -> voltage curve from /dac/calibration (null until loaded)
+    calibration: null,
+
     initialize: function() {
       console.log("Initializing control module...");
-      this.getInitialLEDState();
-      this.getInitialDACValue();
+      this.loadCalibration();
     },
-    
-    // Get initial LED state
-    getInitialLEDState: function() {
+
+    // Fetch the DAC calibration, then the current value again so the voltage display uses it
+    loadCalibration: function() {
       var xhr = new XMLHttpRequest();
-      xhr.open("GET", "/ledstate", true);
+      xhr.open("GET", "/dac/calibration", true);
       xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4 && xhr.status == 200) {
-          try {
-            var state = xhr.responseText;
-            console.log("Initial LED state: " + state);
-            document.getElementById("led-status").innerHTML = "LED Status: " + (state == "1" ? "ON" : "OFF");
-          } catch (e) {
-            console.error("Error processing LED state:", e);
+        if (xhr.readyState == 4) {
+          if (xhr.status == 200) {
+            try {
+              controlModule.calibration = JSON.parse(xhr.responseText);
+            } catch (e) {
+              console.error("Error processing DAC calibration:", e);
+            }
           }
+          liveModule.refresh("dac");
         }
       };
       xhr.send();
     },
-    
-    // Get initial DAC value
-    getInitialDACValue: function() {
-      var xhr = new XMLHttpRequest();
-      xhr.open("GET", "/dacstate", true);
-      xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4 && xhr.status == 200) {
-          try {
-            var value = xhr.responseText;
-            console.log("Initial DAC value: " + value);
-            
-            var dacSlider = document.getElementById("dacSlider");
-            if (dacSlider) {
-              dacSlider.value = value;
-            }
-            
-            var dacValue = document.getElementById("dac-value");
-            if (dacValue) {
-              dacValue.innerHTML = "DAC Value: " + value;
-            }
-            
-            var voltageValue = document.getElementById("voltage-value");
-            if (voltageValue) {
-              var voltage = (value / 255 * 3.3).toFixed(2);
-              voltageValue.innerHTML = "Voltage: " + voltage + "V";
-            }
-          } catch (e) {
-            console.error("Error processing DAC state:", e);
-          }
+
+    // Interpolate the output voltage for a DAC code from the calibration points
+    voltageForCode: function(value) {
+      var cal = this.calibration;
+      value = parseInt(value);
+      if (!cal || !cal.codes) {
+        return value / 255 * 3.3;
+      }
+      for (var i = 1; i < cal.codes.length; i++) {
+        if (value <= cal.codes[i]) {
+          var span = cal.codes[i] - cal.codes[i - 1];
+          var mv = cal.pointsMv[i - 1] + (cal.pointsMv[i] - cal.pointsMv[i - 1]) * (value - cal.codes[i - 1]) / span;
+          return mv / 1000;
         }
-      };
-      xhr.send();
+      }
+      return cal.pointsMv[cal.pointsMv.length - 1] / 1000;
+    },
+    
+    displayLEDState: function(on) {
+      document.getElementById("led-status").innerHTML = "LED Status: " + (on ? "ON" : "OFF");
+    },
+
+    // Show a DAC value reported by the board; leaves the slider alone while it is being dragged
+    displayDACValue: function(value) {
+      var dacSlider = document.getElementById("dacSlider");
+      if (dacSlider && document.activeElement !== dacSlider) {
+        dacSlider.value = value;
+      }
+
+      var dacValue = document.getElementById("dac-value");
+      if (dacValue) {
+        dacValue.innerHTML = "DAC Value: " + value;
+      }
+
+      var voltageValue = document.getElementById("voltage-value");
+      if (voltageValue) {
+        var voltage = controlModule.voltageForCode(value).toFixed(2);
+        voltageValue.innerHTML = "Voltage: " + voltage + "V";
+      }
     },
     
     // Toggle LED function
     toggleLED: function(state) {
       console.log("Toggling LED: " + state);
+      // The board confirms over the socket with the next state push
+      if (liveModule.send({ led: state ? 1 : 0 })) {
+        return;
+      }
       var xhr = new XMLHttpRequest();
       xhr.open("GET", "/led?state=" + state, true);
       xhr.onreadystatechange = function () {
@@ -74,76 +91,213 @@ const controlModule = {
     
     // Update DAC function
     updateDAC: function(value) {
-      // Calculate approximate voltage (0-255 maps to 0-3.3V)
-      var voltage = (value / 255 * 3.3).toFixed(2);
+      // Voltage from the board's calibration curve
+      var voltage = this.voltageForCode(value).toFixed(2);
       document.getElementById("dac-value").innerHTML = "DAC Value: " + value;
       document.getElementById("voltage-value").innerHTML = "Voltage: " + voltage + "V";
   
-      console.log("Updating DAC to: " + value + " (voltage: " + voltage + "V)");
-  
-      // Send value to server immediately - no delay
+      // Over the socket every value goes straight out; the board coalesces them
+      if (liveModule.send({ dac: parseInt(value) })) {
+        return;
+      }
+
+      // While a request is outstanding only remember the newest value;
+      // it is sent as soon as the current request completes
+      if (this.dacRequestInFlight) {
+        this.pendingDACValue = value;
+        return;
+      }
+      this.sendDAC(value);
+    },
+
+    sendDAC: function(value) {
+      controlModule.dacRequestInFlight = true;
+
       var xhr = new XMLHttpRequest();
       xhr.open("GET", "/dac?value=" + value, true);
-      xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4 && xhr.status == 200) {
-          console.log("DAC update response received: " + xhr.responseText);
+      xhr.timeout = 5000;
+      xhr.onloadend = function () {
+        controlModule.dacRequestInFlight = false;
+
+        var next = controlModule.pendingDACValue;
+        controlModule.pendingDACValue = null;
+        if (next !== null && next != value) {
+          controlModule.sendDAC(next);
         }
       };
       xhr.send();
     },
     
-    // Update sensor readings
-    updateSensorReadings: function() {
+    // Request an exact output voltage; the board picks the code from its calibration
+    setVoltage: function() {
+      var volts = document.getElementById("voltage-target").value;
       var xhr = new XMLHttpRequest();
-      xhr.open("GET", "/sensor", true);
+      xhr.open("GET", "/dac/voltage?v=" + volts, true);
       xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4 && xhr.status == 200) {
+        if (xhr.readyState == 4) {
           try {
-            console.log("Sensor data received: " + xhr.responseText);
-            var sensorData = JSON.parse(xhr.responseText);
-  
-            if (sensorData.ready) {
-              document.getElementById("temperature").innerHTML = sensorData.temperature.toFixed(1);
-              document.getElementById("humidity").innerHTML = sensorData.humidity.toFixed(1);
-            } else {
-              document.getElementById("temperature").innerHTML = "--";
-              document.getElementById("humidity").innerHTML = "--";
+            var result = JSON.parse(xhr.responseText);
+            if (xhr.status != 200) {
+              alert(result.error);
+              return;
             }
+            document.getElementById("dacSlider").value = result.value;
+            document.getElementById("dac-value").innerHTML = "DAC Value: " + result.value;
+            document.getElementById("voltage-value").innerHTML = "Voltage: " + result.voltage.toFixed(2) + "V";
           } catch (e) {
-            console.error("Error processing sensor data:", e);
+            console.error("Error processing voltage response:", e);
           }
         }
       };
       xhr.send();
     },
-    
-    // Update connection status
-    updateConnectionStatus: function() {
+
+    // Ask the board for a timer-driven ramp; one request regardless of ramp length
+    startRamp: function() {
+      var target = document.getElementById("ramp-target").value;
+      var duration = document.getElementById("ramp-duration").value;
+      var status = document.getElementById("ramp-status");
+
       var xhr = new XMLHttpRequest();
-      xhr.open("GET", "/clients", true);
+      xhr.open("GET", "/dac/ramp?target=" + target + "&duration=" + duration, true);
       xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4 && xhr.status == 200) {
+        if (xhr.readyState == 4) {
           try {
-            var count = parseInt(xhr.responseText);
-            console.log("Connection status updated, client count: " + count);
-            document.getElementById("client-count").innerHTML = count;
-  
-            // Update connection indicator
-            var dot = document.getElementById("connection-dot");
-            var text = document.getElementById("connection-text");
-  
-            if (count > 1) { // Count includes this client
-              dot.className = "status-indicator status-green";
-              text.innerHTML = "Other client(s) connected.";
-            } else {
-              dot.className = "status-indicator status-red";
-              text.innerHTML = "No other clients connected.";
+            var ramp = JSON.parse(xhr.responseText);
+            if (xhr.status != 200) {
+              status.innerHTML = "Ramp error: " + ramp.error;
+              return;
             }
+            status.innerHTML = ramp.ramping ? "Ramping to " + ramp.target + " over " + ramp.durationMs + " ms" : "";
+
+            // Reflect the end point on the slider once the ramp has had time to finish
+            setTimeout(function() { liveModule.refresh("dac"); }, ramp.remainingMs + 100);
           } catch (e) {
-            console.error("Error processing connection data:", e);
+            console.error("Error processing ramp state:", e);
           }
         }
       };
       xhr.send();
+    },
+
+    // Start the hardware-timed waveform generator
+    startWaveform: function() {
+      var engine = document.getElementById("waveform-engine").value;
+      var shape = document.getElementById("waveform-shape").value;
+      var freq = document.getElementById("waveform-freq").value;
+      var amplitude = document.getElementById("waveform-amplitude").value;
+      var offset = document.getElementById("waveform-offset").value;
+      var pairing = document.getElementById("waveform-pairing").value;
+      var phase = document.getElementById("waveform-phase").value;
+
+      console.log("Starting waveform: " + shape + " at " + freq + " Hz (" + engine + ", channel 2: " + pairing + ")");
+
+      // The DDS engine drives both channels as one generator
+      var url = engine == "dds"
+        ? "/generator?pairing=" + pairing + "&phase=" + phase + "&"
+        : "/waveform?";
+
+      var xhr = new XMLHttpRequest();
+      xhr.open("GET", url + "shape=" + shape + "&freq=" + freq +
+        "&amplitude=" + amplitude + "&offset=" + offset, true);
+      xhr.onreadystatechange = function () {
+        if (xhr.readyState == 4) {
+          controlModule.displayWaveformStatus(xhr);
+        }
+      };
+      xhr.send();
+    },
+
+    // Channel pairing only applies to the DDS generator; the phase box only to custom phase
+    updatePairingControls: function() {
+      var pairing = document.getElementById("waveform-pairing").value;
+      var phaseGroup = document.getElementById("waveform-phase-group");
+      if (pairing == "phase") {
+        phaseGroup.classList.remove("hidden");
+      } else {
+        phaseGroup.classList.add("hidden");
+      }
+      if (pairing != "none") {
+        document.getElementById("waveform-engine").value = "dds";
+      }
+    },
+
+    // Stop the waveform generator and return to the static DAC level
+    stopWaveform: function() {
+      var xhr = new XMLHttpRequest();
+      xhr.open("GET", "/waveform/stop", true);
+      xhr.onreadystatechange = function () {
+        if (xhr.readyState == 4) {
+          controlModule.displayWaveformStatus(xhr);
+        }
+      };
+      xhr.send();
+    },
+
+    // Start a DDS frequency sweep using the shape and level from the generator form
+    startSweep: function() {
+      var params = "start=" + document.getElementById("sweep-start").value +
+        "&end=" + document.getElementById("sweep-end").value +
+        "&duration=" + document.getElementById("sweep-duration").value +
+        "&mode=" + document.getElementById("sweep-mode").value +
+        "&shape=" + document.getElementById("waveform-shape").value +
+        "&amplitude=" + document.getElementById("waveform-amplitude").value +
+        "&offset=" + document.getElementById("waveform-offset").value;
+
+      console.log("Starting sweep: " + params);
+
+      var xhr = new XMLHttpRequest();
+      xhr.open("GET", "/dds/sweep?" + params, true);
+      xhr.onreadystatechange = function () {
+        if (xhr.readyState == 4) {
+          controlModule.displayWaveformStatus(xhr);
+        }
+      };
+      xhr.send();
+    },
+
+    displayWaveformStatus: function(xhr) {
+      var status = document.getElementById("waveform-status");
+      try {
+        var state = JSON.parse(xhr.responseText);
+        if (xhr.status != 200) {
+          status.innerHTML = "Waveform error: " + state.error;
+        } else if (state.running) {
+          status.innerHTML = "Waveform: " + state.shape + " at " +
+            state.actualFrequency.toFixed(2) + " Hz (" + state.engine + ", " + state.sampleRate + " samples/s" +
+            (state.pairing != "none" ? ", channel 2 " + state.pairing : "") +
+            (state.sweeping ? ", sweeping to " + state.frequency + " Hz" : "") + ")";
+        } else {
+          status.innerHTML = "Waveform: stopped";
+        }
+      } catch (e) {
+        console.error("Error processing waveform state:", e);
+      }
+    },
+
+    displaySensorData: function(sensorData) {
+      if (sensorData.ready) {
+        document.getElementById("temperature").innerHTML = sensorData.temperature.toFixed(1);
+        document.getElementById("humidity").innerHTML = sensorData.humidity.toFixed(1);
+      } else {
+        document.getElementById("temperature").innerHTML = "--";
+        document.getElementById("humidity").innerHTML = "--";
+      }
+    },
+    
+    displayConnectionStatus: function(count) {
+      document.getElementById("client-count").innerHTML = count;
+
+      // Update connection indicator
+      var dot = document.getElementById("connection-dot");
+      var text = document.getElementById("connection-text");
+
+      if (count > 1) { // Count includes this client
+        dot.className = "status-indicator status-green";
+        text.innerHTML = "Other client(s) connected.";
+      } else {
+        dot.className = "status-indicator status-red";
+        text.innerHTML = "No other clients connected.";
+      }
     }
   };
\ No newline at end of file
@@ -0,0 +1,130 @@
+// liveModule.js - Live dashboard state pushed over a WebSocket, with /api/state polling as fallback
+
+const liveModule = {
+  socket: null,
+  connected: false,
+  reconnectDelay: 1000,
+  poller: null,
+  // Last complete state version seen; polls only fetch what changed after it
+  version: 0,
+
+  initialize: function() {
+    console.log("Initializing live state module...");
+    this.connect();
+  },
+
+  connect: function() {
+    if (!("WebSocket" in window)) {
+      this.startPolling();
+      return;
+    }
+
+    var socket = new WebSocket("ws://" + window.location.host + "/ws");
+    this.socket = socket;
+
+    socket.onopen = function() {
+      console.log("Live state socket connected");
+      liveModule.connected = true;
+      liveModule.reconnectDelay = 1000;
+      liveModule.stopPolling();
+    };
+
+    socket.onmessage = function(event) {
+      try {
+        var state = JSON.parse(event.data);
+        liveModule.version = state.version;
+        liveModule.applyState(state);
+      } catch (e) {
+        console.error("Error processing live state:", e);
+      }
+    };
+
+    // Poll while the socket is down and keep trying to get it back, backing off up to 30 s
+    socket.onclose = function() {
+      console.log("Live state socket closed, polling instead");
+      liveModule.connected = false;
+      liveModule.socket = null;
+      liveModule.startPolling();
+      setTimeout(function() { liveModule.connect(); }, liveModule.reconnectDelay);
+      liveModule.reconnectDelay = Math.min(liveModule.reconnectDelay * 2, 30000);
+    };
+  },
+
+  // Returns false when there is no socket, so callers fall back to plain requests
+  send: function(command) {
+    if (!this.connected) {
+      return false;
+    }
+    this.socket.send(JSON.stringify(command));
+    return true;
+  },
+
+  // Messages only carry the groups that changed
+  applyState: function(state) {
+    if (state.sensor !== undefined) {
+      controlModule.displaySensorData(state.sensor);
+    }
+    if (state.clients !== undefined) {
+      controlModule.displayConnectionStatus(state.clients);
+    }
+    if (state.led !== undefined) {
+      controlModule.displayLEDState(state.led == 1);
+    }
+    if (state.dac !== undefined) {
+      controlModule.displayDACValue(state.dac);
+    }
+    if (state.battery !== undefined) {
+      sysInfoModule.displayBattery(state.battery);
+    }
+  },
+
+  // One request for the whole dashboard; 304 means nothing changed since the last poll
+  pollState: function() {
+    var xhr = new XMLHttpRequest();
+    xhr.open("GET", "/api/state?since=" + liveModule.version, true);
+    xhr.onreadystatechange = function () {
+      if (xhr.readyState == 4 && xhr.status == 200) {
+        try {
+          var state = JSON.parse(xhr.responseText);
+          liveModule.version = state.version;
+          liveModule.applyState(state);
+        } catch (e) {
+          console.error("Error processing live state:", e);
+        }
+      }
+    };
+    xhr.send();
+  },
+
+  // Re-read some groups right away, e.g. "dac" after a ramp; does not touch the
+  // version because the reply leaves the other groups out
+  refresh: function(fields) {
+    var xhr = new XMLHttpRequest();
+    xhr.open("GET", "/api/state?fields=" + fields, true);
+    xhr.onreadystatechange = function () {
+      if (xhr.readyState == 4 && xhr.status == 200) {
+        try {
+          liveModule.applyState(JSON.parse(xhr.responseText));
+        } catch (e) {
+          console.error("Error processing live state:", e);
+        }
+      }
+    };
+    xhr.send();
+  },
+
+  startPolling: function() {
+    if (this.poller !== null) {
+      return;
+    }
+    this.pollState();
+    this.poller = setInterval(liveModule.pollState, 2000);
+  },
+
+  stopPolling: function() {
+    if (this.poller !== null) {
+      clearInterval(this.poller);
+      this.poller = null;
+    }
+  }
+};
@@ -11,11 +11,10 @@ window.onload = function () {
       sysInfoModule.initialize();
       ethernetModule.initialize();
       
-      // Start polling for connection status and sensor readings
-      controlModule.updateSensorReadings(); // Initial reading
+      // Sensor, client count, LED, DAC and battery arrive over the live socket
+      // (which polls on its own if the socket is unavailable)
+      liveModule.initialize();
       console.log("Setting up polling...");
-      setInterval(controlModule.updateConnectionStatus, 2000);
-      setInterval(controlModule.updateSensorReadings, 2000);
       setInterval(ethernetModule.getEthernetStatus, 10000);
       
       // Initialize tab navigation
@@ -12,98 +12,100 @@ const scannerModule = {
       }
     },
     
-    // Scan I2C bus function
+    // Start a background scan, then poll its status; devices show up as they are found
     scanI2C: function() {
       console.log("I2C scan button clicked");
-  
-      // Cache DOM elements to ensure they exist
+
       const scanButton = document.getElementById('scan-button');
       const scanStatus = document.getElementById('scan-status');
-      const devicesTable = document.getElementById('devices-table');
-      const devicesList = document.getElementById('devices-list');
-  
+
       if (!scanButton || !scanStatus) {
         console.error("Could not find scan-button or scan-status elements");
         return;
       }
-  
-      // Disable button and show scanning message
+
       scanButton.disabled = true;
       scanButton.innerHTML = "Scanning...";
-      scanStatus.innerHTML = "Scanning I2C bus, please wait...";
-  
-      // Hide the table during scan
+      scanStatus.innerHTML = "Scanning I2C bus...";
+
+      const devicesTable = document.getElementById('devices-table');
       if (devicesTable) {
         devicesTable.classList.add('hidden');
       }
-  
-      console.log("Sending scan request...");
-  
-      // Create a new XHR object for the scan request
+
       var xhr = new XMLHttpRequest();
       xhr.open("GET", "/scan", true);
-      
-      // Set timeout to handle potential network issues
-      xhr.timeout = 15000; // 15 seconds timeout
-      
+      xhr.timeout = 5000;
       xhr.onreadystatechange = function () {
-        if (xhr.readyState == 4) {
-          // Re-enable button regardless of result
-          if (scanButton) {
-            scanButton.disabled = false;
-            scanButton.innerHTML = "Scan I2C Bus";
-          }
-          
-          if (xhr.status == 200) {
-            console.log("Scan results received: " + xhr.responseText);
-            try {
-              const results = JSON.parse(xhr.responseText);
-              // Explicitly call a function to handle the display on a short timeout
-              // This helps Safari process the DOM updates
-              setTimeout(function() {
-                scannerModule.displayScanResults(results);
-              }, 50);
-            } catch (e) {
-              console.error("Error parsing scan results: " + e);
-              if (scanStatus) {
-                scanStatus.innerHTML = "Error parsing scan results.";
-              }
-            }
-          } else {
-            console.error("Scan request failed with status: " + xhr.status);
-            if (scanStatus) {
-              scanStatus.innerHTML = "Error performing scan. Server returned status " + xhr.status;
-            }
-          }
+        if (xhr.readyState != 4 || xhr.status == 0) {
+          return;
+        }
+        // 409: a scan started elsewhere is still running, follow that one
+        if (xhr.status == 202 || xhr.status == 409) {
+          scannerModule.pollScan();
+        } else {
+          scannerModule.scanFailed("Error starting scan. Server returned status " + xhr.status);
         }
       };
-      
-      // Handle timeout
       xhr.ontimeout = function() {
-        console.error("Scan request timed out");
-        if (scanButton) {
-          scanButton.disabled = false;
-          scanButton.innerHTML = "Scan I2C Bus";
-        }
-        if (scanStatus) {
-          scanStatus.innerHTML = "Scan request timed out. Please try again.";
-        }
+        scannerModule.scanFailed("Scan request timed out. Please try again.");
       };
-      
-      // Handle network errors
       xhr.onerror = function() {
-        console.error("Network error during scan request");
-        if (scanButton) {
-          scanButton.disabled = false;
-          scanButton.innerHTML = "Scan I2C Bus";
+        scannerModule.scanFailed("Network error during scan. Please try again.");
+      };
+      xhr.send();
+    },
+
+    pollScan: function() {
+      var xhr = new XMLHttpRequest();
+      xhr.open("GET", "/scan/status", true);
+      xhr.timeout = 5000;
+      xhr.onreadystatechange = function () {
+        if (xhr.readyState != 4 || xhr.status == 0) {
+          return;
         }
-        if (scanStatus) {
-          scanStatus.innerHTML = "Network error during scan. Please try again.";
+        if (xhr.status != 200) {
+          scannerModule.scanFailed("Error reading scan status. Server returned status " + xhr.status);
+          return;
+        }
+        try {
+          const results = JSON.parse(xhr.responseText);
+          scannerModule.displayScanResults(results);
+          if (results.state == "running") {
+            setTimeout(scannerModule.pollScan, 250);
+          } else {
+            scannerModule.resetButton();
+          }
+        } catch (e) {
+          console.error("Error parsing scan results: " + e);
+          scannerModule.scanFailed("Error parsing scan results.");
         }
       };
-      
+      xhr.ontimeout = function() {
+        scannerModule.scanFailed("Scan status request timed out. Please try again.");
+      };
+      xhr.onerror = function() {
+        scannerModule.scanFailed("Network error during scan. Please try again.");
+      };
       xhr.send();
     },
+
+    scanFailed: function(message) {
+      console.error(message);
+      const scanStatus = document.getElementById('scan-status');
+      if (scanStatus) {
+        scanStatus.innerHTML = message;
+      }
+      this.resetButton();
+    },
+
+    resetButton: function() {
+      const scanButton = document.getElementById('scan-button');
+      if (scanButton) {
+        scanButton.disabled = false;
+        scanButton.innerHTML = "Scan I2C Bus";
+      }
+    },
     
     // Display scan results function
     displayScanResults: function(results) {
@@ -119,12 +121,15 @@ const scannerModule = {
         return;
       }
   
-      // Clear previous results - using a more compatible method
-      while (devicesList.firstChild) {
-        devicesList.removeChild(devicesList.firstChild);
-      }
-  
-      if (results && results.scanComplete) {
+      if (results && results.state == "running") {
+        scanStatus.innerHTML = "Scanning I2C bus... " + results.probed + "/" + results.total +
+          " addresses, " + results.devices.length + " found so far.";
+        if (results.devices.length > 0) {
+          devicesTable.style.display = "table";
+          devicesTable.classList.remove('hidden');
+          scannerModule.fillDevices(devicesList, results.devices);
+        }
+      } else if (results && results.scanComplete) {
         if (results.devices && results.devices.length > 0) {
           scanStatus.innerHTML = "Scan complete. Found " + results.devices.length +
             " device" + (results.devices.length > 1 ? "s" : "") + " on the I2C bus.";
@@ -133,21 +138,7 @@ const scannerModule = {
           devicesTable.style.display = "table";
           devicesTable.classList.remove('hidden');
   
-          results.devices.forEach(function(device) {
-            console.log("Adding device to table:", device);
-  
-            const row = document.createElement('tr');
-  
-            const decimalCell = document.createElement('td');
-            decimalCell.textContent = device.address;
-  
-            const hexCell = document.createElement('td');
-            hexCell.textContent = device.hexAddress;
-  
-            row.appendChild(decimalCell);
-            row.appendChild(hexCell);
-            devicesList.appendChild(row);
-          });
+          scannerModule.fillDevices(devicesList, results.devices);
         } else {
           scanStatus.innerHTML = "Scan complete. No I2C devices found.";
           devicesTable.classList.add('hidden');
@@ -156,5 +147,36 @@ const scannerModule = {
         scanStatus.innerHTML = "Error performing scan or invalid response.";
         devicesTable.classList.add('hidden');
       }
+    },
+
+    // Rebuild the device table rows
+    fillDevices: function(devicesList, devices) {
+      while (devicesList.firstChild) {
+        devicesList.removeChild(devicesList.firstChild);
+      }
+
+      devices.forEach(function(device) {
+        const row = document.createElement('tr');
+
+        const decimalCell = document.createElement('td');
+        decimalCell.textContent = device.address;
+
+        const hexCell = document.createElement('td');
+        hexCell.textContent = device.hexAddress;
+
+        // Parts named by address alone are marked as a guess
+        const partCell = document.createElement('td');
+        if (device.part) {
+          partCell.textContent = device.part + " (" + device.kind + ")" + (device.confirmed ? "" : "?");
+          partCell.title = device.confirmed ? "Confirmed by ID register" : "Guessed from address";
+        } else {
+          partCell.textContent = "Unknown";
+        }
+
+        row.appendChild(decimalCell);
+        row.appendChild(hexCell);
+        row.appendChild(partCell);
+        devicesList.appendChild(row);
+      });
     }
   };
\ No newline at end of file
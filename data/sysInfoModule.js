@@ -3,6 +3,8 @@
 const sysInfoModule = {
   // Variable to store the auto-refresh interval ID
   refreshInterval: null,
+  // Telemetry stream from /events, preferred over polling when available
+  eventSource: null,
   
   initialize: function() {
     console.log("Initializing system info module...");
@@ -18,7 +20,33 @@ const sysInfoModule = {
   startSystemInfoAutoRefresh: function() {
     // Clear any existing interval first
     this.stopSystemInfoAutoRefresh();
-    
+
+    // One long-lived stream instead of a request per second
+    if (window.EventSource) {
+      this.eventSource = new EventSource("/events?interval=1000");
+      this.eventSource.addEventListener("telemetry", function(event) {
+        try {
+          sysInfoModule.displaySystemInfo(JSON.parse(event.data));
+        } catch (e) {
+          console.error("Error parsing telemetry event: " + e);
+        }
+      });
+      // The browser reconnects on its own; only give up if the server refuses the stream
+      this.eventSource.onerror = function() {
+        if (sysInfoModule.eventSource && sysInfoModule.eventSource.readyState === EventSource.CLOSED) {
+          console.log("Telemetry stream unavailable, polling instead");
+          sysInfoModule.eventSource = null;
+          sysInfoModule.startPolling();
+        }
+      };
+      console.log("System info stream started");
+      return;
+    }
+
+    this.startPolling();
+  },
+
+  startPolling: function() {
     // Set new interval to update every 1000ms (1 second)
     this.refreshInterval = setInterval(function() {
       sysInfoModule.updateSystemInfo(false); // Pass false to indicate this is an auto-refresh (don't show loading state)
@@ -29,6 +57,11 @@ const sysInfoModule = {
   
   // Stop auto-refresh
   stopSystemInfoAutoRefresh: function() {
+    if (this.eventSource !== null) {
+      this.eventSource.close();
+      this.eventSource = null;
+      console.log("System info stream stopped");
+    }
     if (this.refreshInterval !== null) {
       clearInterval(this.refreshInterval);
       this.refreshInterval = null;
@@ -170,37 +203,42 @@ const sysInfoModule = {
     
     // Battery information
     if (info.battery) {
-      // Battery connected status
-      const connected = info.battery.connected;
-      document.getElementById('battery-connected').textContent = connected ? "Yes" : "No";
-      
-      // Battery percentage
-      const percentage = info.battery.percentage;
-      if (percentage !== undefined && connected) {
-        document.getElementById('battery-percentage').textContent = percentage.toFixed(1) + "%";
-      } else {
-        document.getElementById('battery-percentage').textContent = connected ? "Calculating..." : "N/A";
-      }
-      
-      // Battery voltage
-      const voltage = info.battery.voltage;
-      if (voltage !== undefined && connected) {
-        document.getElementById('battery-voltage').textContent = voltage.toFixed(2) + " V";
-      } else {
-        document.getElementById('battery-voltage').textContent = connected ? "Calculating..." : "N/A";
-      }
-      
-      // Power source
-      const usbPowered = info.battery.usbPowered;
-      document.getElementById('power-source').textContent = usbPowered ? "USB" : (connected ? "Battery" : "USB");
-      
-      // Charging status
-      const charging = info.battery.charging;
-      if (charging !== undefined && connected) {
-        document.getElementById('charging-status').textContent = charging ? "Charging" : "Not Charging";
-      } else {
-        document.getElementById('charging-status').textContent = "N/A";
-      }
+      sysInfoModule.displayBattery(info.battery);
+    }
+  },
+
+  // Also fed directly by the live state push
+  displayBattery: function(battery) {
+    // Battery connected status
+    const connected = battery.connected;
+    document.getElementById('battery-connected').textContent = connected ? "Yes" : "No";
+
+    // Battery percentage
+    const percentage = battery.percentage;
+    if (percentage !== undefined && connected) {
+      document.getElementById('battery-percentage').textContent = percentage.toFixed(1) + "%";
+    } else {
+      document.getElementById('battery-percentage').textContent = connected ? "Calculating..." : "N/A";
+    }
+
+    // Battery voltage
+    const voltage = battery.voltage;
+    if (voltage !== undefined && connected) {
+      document.getElementById('battery-voltage').textContent = voltage.toFixed(2) + " V";
+    } else {
+      document.getElementById('battery-voltage').textContent = connected ? "Calculating..." : "N/A";
+    }
+
+    // Power source
+    const usbPowered = battery.usbPowered;
+    document.getElementById('power-source').textContent = usbPowered ? "USB" : (connected ? "Battery" : "USB");
+
+    // Charging status
+    const charging = battery.charging;
+    if (charging !== undefined && connected) {
+      document.getElementById('charging-status').textContent = charging ? "Charging" : "Not Charging";
+    } else {
+      document.getElementById('charging-status').textContent = "N/A";
     }
   }
 };
\ No newline at end of file
@@ -5,18 +5,28 @@
 #include <Arduino.h>
 #include <Adafruit_LC709203F.h>
 #include <ArduinoJson.h>
+#include "i2c_bus.h"
 
 class BatteryManager {
 private:
   Adafruit_LC709203F lc;
+  I2CBus* bus;
+  float cachedVoltage;
+  float cachedPercent;
+  unsigned long sampleTime;
+  bool sampleValid;
   float lastVoltage;
   unsigned long lastCheckTime;
   bool lastPowerState;
   bool monitorAvailable;
 
 public:
-  BatteryManager();
+  BatteryManager(I2CBus* bus);
   bool begin();
+
+  // Reads voltage and percentage together under one bus lock, at most once
+  // per BATTERY_SAMPLE_MAX_AGE; the getters below all use this sample
+  bool sample();
   bool isConnected();
   bool isUSBPowered();
   bool isCharging();
@@ -0,0 +1,22 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// Minimal CBOR (RFC 8949) encoder for ArduinoJson documents.
+//
+// ArduinoJson writes MessagePack itself but not CBOR; this covers the same
+// data model (null, bool, integers, floats, strings, arrays, maps) with
+// definite lengths only. The calls mirror measureMsgPack()/serializeMsgPack().
+namespace cbor
+{
+    // Bytes serialize() will write for this value
+    size_t measure(JsonVariantConst source);
+
+    // Writes the encoding into buffer; returns the length, or 0 if it does not fit
+    size_t serialize(JsonVariantConst source, uint8_t *buffer, size_t capacity);
+}
+
+#endif // CBOR_H
@@ -17,9 +17,100 @@ const int DAC_PIN = 18;       // A0 on ESP32-S2 Feather = GPIO18
 const int NEOPIXEL_PIN = 33;  // ESP32-S2 Feather built-in NeoPixel
 const int NEOPIXEL_COUNT = 1; // Single NeoPixel
 const int DHTPIN = 4;         // DHT11 sensor connected to GPIO4
+const int TRIGGER_PIN = 5;    // External trigger input, D5 on ESP32-S2 Feather = GPIO5
 #define DHTTYPE DHT11         // DHT 11 sensor type
 
 // Timing constants
 const unsigned long SENSOR_READ_INTERVAL = 2000; // Read sensor every 2 seconds
 
+// DAC waveform engine
+const uint8_t DAC_TIMER_NUM = 0;            // Hardware timer used as the DAC sample clock
+const uint16_t DAC_TIMER_DIVIDER = 2;       // 80 MHz APB / 2 = 40 MHz timer tick
+const uint32_t DAC_TIMER_HZ = 80000000UL / DAC_TIMER_DIVIDER;
+const uint32_t DAC_MAX_SAMPLE_RATE = 40000; // Upper bound for the sample ISR rate
+const uint32_t DAC_DDS_SAMPLE_RATE = 40000; // Fixed sample clock in DDS mode (divides DAC_TIMER_HZ exactly)
+const unsigned long DAC_SETPOINT_INTERVAL = 20; // Apply web setpoints at most every 20 ms (50 Hz)
+const uint32_t DAC_RAMP_TICK_HZ = 1000;     // Ramp interpolation steps per second
+const float DAC_FULL_SCALE_VOLTS = 3.3;     // Nominal output at code 255
+const size_t DAC_STREAM_BUFFER_SIZE = 16384; // Ring buffer for uploaded samples (power of two)
+
+// DAC voltage calibration
+const size_t DAC_CALIBRATION_POINTS = 17;    // Codes 0, 16, 32, ... 240, 255
+const uint16_t DAC_CALIBRATION_MAX_MV = 3300;
+const uint16_t DAC_CALIBRATION_STEP_MV = 4;  // Resolution of the voltage -> code table
+
+// Closed-loop DAC output (ADC loopback)
+const int FEEDBACK_ADC_PIN = 8;                 // A5 on ESP32-S2 Feather = GPIO8 (ADC1), wire to the DAC output
+const uint32_t FEEDBACK_DEFAULT_RATE_HZ = 200;  // Control loop rate
+const uint32_t FEEDBACK_MAX_RATE_HZ = 1000;     // Rates must also divide the FreeRTOS tick rate
+const int32_t FEEDBACK_DEFAULT_KP = 1311;       // Q16 codes per mV (~0.02)
+const int32_t FEEDBACK_DEFAULT_KI = 328;        // Q16 codes per mV per sample (~0.005)
+const int32_t FEEDBACK_MAX_GAIN = 16 * 65536;   // Q16, for kp and ki alike (16 codes per mV)
+const int32_t FEEDBACK_TOLERANCE_MV = 15;       // |error| counted as settled
+const uint32_t FEEDBACK_SETTLE_SAMPLES = 10;    // Consecutive in-tolerance samples to call it settled
+
+// Setpoint sequencer
+const uint8_t SEQUENCER_TIMER_NUM = 1;       // Hardware timer that schedules sequence steps
+const uint16_t SEQUENCER_TIMER_DIVIDER = 80; // 80 MHz APB / 80 = 1 us resolution
+const size_t MAX_SEQUENCE_STEPS = 256;
+const size_t SEQUENCE_JITTER_HISTORY = 512;  // Most recent step deviations kept for percentiles
+const uint32_t SEQUENCE_START_DELAY_US = 100; // Gap between start() and cycle time zero
+
+// Web server (esp_http_server in its own task)
+const uint32_t HTTP_SERVER_STACK_SIZE = 8192;
+const uint8_t HTTP_SERVER_PRIORITY = 1;      // Same as loop(), below the DAC feedback task
+const uint16_t HTTP_MAX_OPEN_SOCKETS = 7;    // lwIP allows 10 sockets, the server keeps 3 for itself
+const size_t HTTP_MAX_URI_HANDLERS = 4;      // One wildcard per method in the route table, plus /ws
+const size_t HTTP_MAX_BODY_SIZE = 8192;      // Largest body collected by arg("plain")
+const size_t HTTP_CHUNK_SIZE = 1024;         // File and upload transfer unit
+const int HTTP_RECV_RETRIES = 3;             // Receive timeouts tolerated while reading a body
+const unsigned long HTTP_IDLE_TIMEOUT = 15000;   // Keep-alive connections with no request for this long are closed
+const unsigned long HTTP_IDLE_SWEEP_INTERVAL = 1000;
+const uint32_t HTTP_MAX_KEEPALIVE_REQUESTS = 100; // Requests per connection before it is closed
+const size_t ASSET_CACHE_BUDGET = 32768;     // RAM for cached static assets (gzipped bytes)
+const size_t ASSET_CACHE_MAX_FILE = 16384;   // Larger assets are always streamed from flash
+
+// Live dashboard state pushed over WebSocket
+const unsigned long STATE_PUBLISH_INTERVAL = 50;    // Change detection period, keeps UI latency under 100 ms
+const unsigned long STATE_BATTERY_INTERVAL = 5000;  // The battery monitor is read over I2C, so less often
+const size_t WS_MAX_MESSAGE_SIZE = 256;             // Largest command frame accepted from a client
+
+// Server-Sent Events telemetry stream
+const size_t SSE_MAX_SUBSCRIBERS = 4;
+const unsigned long SSE_TICK_INTERVAL = 100;        // Subscriber intervals are rounded to this
+const uint32_t SSE_MIN_INTERVAL = 250;              // Fastest rate a client may ask for (ms)
+const uint32_t SSE_MAX_INTERVAL = 60000;
+const uint32_t SSE_DEFAULT_INTERVAL = 1000;
+
+// Shared I2C bus
+const uint32_t I2C_BUS_CLOCK = 100000;              // Default clock; the LC709203F tops out at 100 kHz
+const size_t I2C_MAX_WAITERS = 8;                   // Tasks that can queue for the bus at once
+const uint32_t I2C_LOCK_TIMEOUT_MS = 200;
+const unsigned long BATTERY_SAMPLE_MAX_AGE = 500;   // Gauge readings reused within this window (ms)
+
+// Background I2C scan
+const uint8_t I2C_SCAN_FIRST_ADDRESS = 0x01;
+const uint8_t I2C_SCAN_LAST_ADDRESS = 0x7E;
+const uint32_t I2C_SCAN_DEFAULT_CLOCK = 100000;
+const uint32_t I2C_SCAN_MIN_CLOCK = 10000;
+const uint32_t I2C_SCAN_MAX_CLOCK = 400000;
+const uint32_t I2C_SCAN_TASK_STACK_SIZE = 3072;
+const uint8_t I2C_SCAN_TASK_PRIORITY = 1;           // Same as loop(); each probe blocks on the bus, not the CPU
+const size_t I2C_SCAN_MAX_IDENTIFIED = 16;          // Devices named per scan; any beyond are listed by address only
+
+// I2C sensor drivers, attached from scan results and sampled by their own task
+const size_t SENSOR_MAX_DEVICES = 8;
+const size_t SENSOR_MAX_VALUES = 4;                 // Readings one driver can report per sample
+const uint32_t SENSOR_TICK_MS = 50;                 // Scheduler resolution, and the stagger between devices
+const uint32_t SENSOR_TASK_STACK_SIZE = 4096;
+const uint8_t SENSOR_TASK_PRIORITY = 1;
+const float INA219_SHUNT_OHMS = 0.1f;               // Shunt fitted on the common INA219 breakouts
+
+// Asynchronous logger (formatted into a ring buffer, written to Serial by its own task)
+const size_t LOG_BUFFER_SIZE = 4096;
+const size_t LOG_LINE_MAX = 192;                    // Longer lines are cut short
+const uint32_t LOG_TASK_STACK_SIZE = 3072;
+const uint8_t LOG_TASK_PRIORITY = 0;                // Below loop() and the web server
+const uint32_t LOG_DROP_REPORT_INTERVAL = 1000;     // How often the drop count is checked (ms)
+
 #endif // CONFIG_H
\ No newline at end of file
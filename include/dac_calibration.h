@@ -0,0 +1,40 @@
+#ifndef DAC_CALIBRATION_H
+#define DAC_CALIBRATION_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Measured code-to-voltage curve for the DAC output, persisted in NVS.
+//
+// The measurement is a handful of points; at load time it is expanded into a
+// forward table (every code) and an inverse table (voltage bucket -> code), so
+// answering "which code gives V volts" is a single array lookup.
+class DacCalibration
+{
+private:
+    uint16_t pointsMv[DAC_CALIBRATION_POINTS];                  // Measured output at each calibration code
+    uint16_t forwardMv[256];                                    // Interpolated output for every code
+    uint8_t inverseCode[DAC_CALIBRATION_MAX_MV / DAC_CALIBRATION_STEP_MV + 1];
+    bool measured;                                              // False while using the nominal curve
+
+    void loadDefaults();
+    void buildTables();
+
+public:
+    DacCalibration();
+
+    void begin();
+    bool save(const uint16_t *newPointsMv);
+    void reset();
+
+    static uint8_t codeForPoint(size_t index);
+    uint8_t codeForMillivolts(uint16_t millivolts) const;
+    uint16_t millivoltsForCode(uint8_t code) const;
+    uint16_t getMinMillivolts() const;
+    uint16_t getMaxMillivolts() const;
+    bool isMeasured() const;
+    void populateCalibration(JsonObject root) const;
+};
+
+#endif // DAC_CALIBRATION_H
@@ -1,18 +1,195 @@
 #ifndef DAC_CONTROL_H
 #define DAC_CONTROL_H
 
+#include <Arduino.h>
+#include <ArduinoJson.h>
 #include "config.h"
+#include "waveform_tables.h"
+#include "dds.h"
+#include "setpoint_mailbox.h"
+#include "sample_ring_buffer.h"
+#include "dac_calibration.h"
+
+// What the sample timer ISR is currently producing
+enum class DacOutputMode : uint8_t
+{
+    Static,   // Timer idle, DAC holds 'value'
+    Table,    // Step through the table with a power-of-two stride, timer period sets the frequency
+    Dds,      // Fixed sample clock, 32-bit phase accumulator selects the table entry
+    Ramp,     // Fixed DAC_RAMP_TICK_HZ tick, linear interpolation towards a target code
+    Stream    // Uploaded samples from the ring buffer at a configurable rate
+};
+
+// How DAC_CHANNEL_2 follows DAC_CHANNEL_1 when the generator drives both
+enum class ChannelPairing : uint8_t
+{
+    None,         // Channel 2 unused
+    Quadrature,   // Channel 2 lags by 90 degrees (I/Q)
+    Differential, // Channel 2 mirrored around the offset
+    Phase         // Channel 2 lags by an arbitrary phase
+};
+
+// One generator driving the channel pair from a single sample clock
+struct GeneratorSettings
+{
+    Waveform shape;
+    float frequency;
+    uint8_t amplitude;
+    uint8_t offset;
+    ChannelPairing pairing;
+    float phaseDegrees; // Only used with ChannelPairing::Phase
+};
+
+// What an edge on TRIGGER_PIN starts
+enum class TriggerTarget : uint8_t
+{
+    Waveform, // The preloaded table/DDS waveform, from phase zero
+    Sequence  // The registered sequence handler
+};
+
+typedef void (*TriggerHandler)(void *context);
 
 class DACControl
 {
 private:
     int value;
+    DacCalibration calibration;
+
+    // Setpoints from the web server, applied by update() at a bounded rate
+    SetpointMailbox setpointMailbox;
+    unsigned long lastSetpointTime;
+    uint32_t appliedSetpoints;
+
+    // Waveform engine - everything below is shared with the sample timer ISR
+    hw_timer_t *sampleTimer;
+    portMUX_TYPE timerMux;
+    uint8_t sampleBuffer[WAVE_TABLE_SIZE]; // One period, already scaled to DAC codes
+    uint8_t pairedBuffer[WAVE_TABLE_SIZE]; // Channel 2, pre-shifted/mirrored so both share one index
+    volatile bool pairedOutput;
+    ChannelPairing pairing;
+    float pairPhaseDegrees;
+    volatile uint32_t sampleIndex;
+    volatile uint32_t sampleStride;
+    volatile DacOutputMode outputMode;
+    dds::Oscillator oscillator;
+    volatile uint32_t rampPosition;   // Current output, Q16.16 DAC code
+    volatile int32_t rampStep;        // Q16.16 change per tick
+    volatile uint32_t rampTicksLeft;
+    volatile bool rampCompleted;      // Set by the ISR, acknowledged by settleFinishedOutput()
+    int rampTarget;
+    uint32_t rampDurationMs;
+
+    // Arbitrary waveform playback
+    SampleRingBuffer<DAC_STREAM_BUFFER_SIZE> streamBuffer;
+    uint32_t streamSampleRate;
+    bool streamLoop;
+    volatile bool streamUploadDone;   // No more samples will arrive (one-shot)
+    volatile bool streamFinished;     // One-shot played out, set by the ISR, acknowledged by settleFinishedOutput()
+    bool streamPlaying;
+    bool streamOverflow;
+    bool streamReceiving;             // Between beginStream() and endStream(), until another output takes over
+    volatile uint32_t streamIndex;    // Loop mode read position
+    volatile uint32_t streamLength;   // Loop mode period in samples
+    volatile bool streamStarved;      // Buffer ran dry and no sample has arrived since
+    volatile uint32_t streamUnderruns; // Times the buffer ran dry, not ticks spent empty
+    volatile uint32_t streamSamplesPlayed;
+    uint32_t streamSamplesReceived;
+    void startStreamPlayback();
+
+    // Waveform parameters as requested and as realised by the timer
+    Waveform waveform;
+    float frequency;
+    float actualFrequency;
+    uint32_t sampleRate;
+    uint8_t amplitude;
+    uint8_t offset;
+
+    // External trigger (GPIO edge -> start output from the ISR)
+    volatile bool triggerArmed;
+    bool triggerRearm;
+    int triggerEdge;
+    TriggerTarget triggerTarget;
+    DacOutputMode triggerMode;        // Output mode the waveform trigger restores
+    uint64_t triggerAlarmTicks;
+    uint64_t lastAlarmTicks;
+    TriggerHandler sequenceTrigger;
+    void *sequenceTriggerContext;
+    volatile uint32_t triggerCount;
+    volatile uint32_t lastLatencyCycles;
+    volatile uint32_t minLatencyCycles;
+    volatile uint32_t maxLatencyCycles;
+    static void IRAM_ATTR onTriggerEdge(void *arg);
+    void IRAM_ATTR handleTrigger();
+
+    static DACControl *instance;
+    static void IRAM_ATTR onSampleTimer();
+    void IRAM_ATTR serviceSampleTimer();
+    void fillSampleBuffer();
+    bool prepareWaveform(Waveform shape, uint8_t amplitude, uint8_t offset);
+    bool startOscillator(Waveform shape, float frequency, uint8_t amplitude, uint8_t offset);
+    void armSampleTimer(uint64_t alarmTicks);
+    void settleFinishedOutput();
 
 public:
     DACControl();
     void begin();
     void setValue(int newValue);
     int getValue() const;
+    bool IRAM_ATTR writeFromISR(uint8_t code); // Static output only, for other timer ISRs; false if refused
+    bool trimValue(int newValue);              // Static output only, never stops a waveform; false if one is playing
+
+    // Calibrated output, using the table loaded from NVS in begin()
+    bool setVoltage(float volts);
+    float getVoltage() const;
+    DacCalibration &getCalibration();
+
+    // Coalescing setpoint path: request from any context, applied from loop()
+    void requestValue(int newValue);
+    void update();
+    void populateSetpointStats(JsonObject root) const;
+
+    // Hardware-timed waveform output
+    bool startWaveform(Waveform shape, float frequency, uint8_t amplitude, uint8_t offset);
+    void stopWaveform();
+    bool isWaveformRunning() const;
+    DacOutputMode getOutputMode() const;
+
+    // Direct digital synthesis at DAC_DDS_SAMPLE_RATE with sub-Hz resolution
+    bool startDDS(Waveform shape, float frequency, uint8_t amplitude, uint8_t offset);
+    bool setFrequency(float frequency);
+    bool startSweep(float startFrequency, float endFrequency, uint32_t durationMs, dds::SweepMode mode);
+    float getCurrentFrequency() const;
+    bool isSweeping() const;
+
+    // Timer-driven linear ramps from the current level
+    bool startRamp(int target, uint32_t durationMs);
+    bool startSlew(int target, float voltsPerSecond);
+    bool isRamping() const;
+    void populateRamp(JsonObject root) const;
+
+    // Arbitrary waveform upload: begin, feed samples as they arrive, end
+    bool beginStream(uint32_t sampleRate, bool loop);
+    size_t writeStream(const uint8_t *samples, size_t count);
+    bool endStream();
+    void abortStream();
+    bool isStreamReceiving() const;
+    void populateStream(JsonObject root) const;
+    void populateWaveform(JsonObject root) const;
+
+    // Both DAC channels as one generator, updated together in the same ISR
+    bool startGenerator(const GeneratorSettings &settings);
+    ChannelPairing getPairing() const;
+
+    // External trigger on TRIGGER_PIN; edge is RISING, FALLING or CHANGE
+    bool armTrigger(TriggerTarget target, int edge, bool rearm);
+    void disarmTrigger();
+    void setSequenceTrigger(TriggerHandler handler, void *context);
+    void populateTrigger(JsonObject root) const;
+
+    static bool parseWaveform(const String &name, Waveform &shape);
+    static const char *waveformName(Waveform shape);
+    static bool parsePairing(const String &name, ChannelPairing &pairing);
+    static const char *pairingName(ChannelPairing pairing);
 };
 
-#endif // DAC_CONTROL_H
\ No newline at end of file
+#endif // DAC_CONTROL_H
@@ -0,0 +1,58 @@
+#ifndef DAC_FEEDBACK_H
+#define DAC_FEEDBACK_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "dac_control.h"
+
+// Closes the loop around the DAC: an ADC pin samples the output and a
+// fixed-point PI controller trims the code so the delivered voltage tracks the
+// setpoint under load. Runs in its own FreeRTOS task at a configurable rate.
+class DacFeedbackLoop
+{
+private:
+    DACControl *dacControl;
+    TaskHandle_t taskHandle;
+    portMUX_TYPE paramMux;
+
+    // Parameters (written by the web handler, read by the task)
+    volatile bool enabled;
+    int32_t targetMv;
+    uint32_t rateHz;
+    int32_t kp; // Q16
+    int32_t ki; // Q16
+    bool resetPending; // Set by enable(), applied by the task at its next step
+
+    // Controller state (task only)
+    int32_t integral; // Q16 codes
+    int lastCode;
+
+    // Live metrics
+    volatile int32_t measuredMv;
+    volatile int32_t errorMv;
+    volatile bool settled;
+    volatile uint32_t settlingTimeMs;
+    volatile int32_t steadyStateErrorMv; // Mean error since settling, Q0 (EMA)
+    int32_t steadyStateAccumulator;      // EMA state, Q8
+    uint32_t settleCount;
+    uint32_t samplesSinceChange;
+    uint32_t samplesTaken;
+
+    static void taskEntry(void *param);
+    void run();
+    void step();
+
+public:
+    DacFeedbackLoop(DACControl *dacControl);
+    void begin();
+
+    bool enable(float targetVolts);
+    void disable();
+    bool isEnabled() const;
+    bool setRate(uint32_t hz); // Only rates that divide the tick rate, so the period is exact
+    bool setGains(int32_t kpQ16, int32_t kiQ16);
+    void populateStatus(JsonObject root) const;
+};
+
+#endif // DAC_FEEDBACK_H
@@ -0,0 +1,153 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Direct digital synthesis kernel.
+//
+// The per-sample path (dds::step) is pure integer math with no Arduino or IDF
+// dependencies, so it can run inside the DAC sample ISR and be compiled and
+// benchmarked on the host unchanged. Only the setup helpers use floating point.
+
+// The per-sample helpers must be inlined into the IRAM sample ISR, never called from flash
+#if defined(__GNUC__)
+#define DDS_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define DDS_ALWAYS_INLINE inline
+#endif
+
+namespace dds
+{
+    enum class SweepMode : uint8_t
+    {
+        None,
+        Linear,
+        Logarithmic
+    };
+
+    struct Oscillator
+    {
+        uint32_t phase;            // 32-bit phase accumulator, wraps once per output period
+        uint64_t increment;        // Phase step per sample, Q32.32 (integer part is what phase advances by)
+        SweepMode sweepMode;
+        int64_t linearStep;        // Q32.32 added to the increment every sample (linear sweep)
+        uint32_t logRatio;         // Q2.30 multiplier applied to the increment every sample (log sweep)
+        uint64_t endIncrement;     // Increment to land on when the sweep finishes
+        uint32_t sweepSamplesLeft;
+    };
+
+    // Convert a frequency to a Q32.32 increment (setup only, not for ISR use)
+    inline uint64_t incrementForFrequency(double hz, uint32_t sampleRate)
+    {
+        return static_cast<uint64_t>(hz / sampleRate * 4294967296.0 * 4294967296.0 + 0.5);
+    }
+
+    inline double frequencyForIncrement(uint64_t increment, uint32_t sampleRate)
+    {
+        return static_cast<double>(increment) / (4294967296.0 * 4294967296.0) * sampleRate;
+    }
+
+    // Lowest frequency the oscillator can produce: step() advances the 32-bit
+    // phase by the integer part of the increment, so anything below one phase
+    // LSB per sample would never move
+    inline double minFrequency(uint32_t sampleRate)
+    {
+        return sampleRate / 4294967296.0;
+    }
+
+    inline void reset(Oscillator &osc, uint64_t increment)
+    {
+        osc.phase = 0;
+        osc.increment = increment;
+        osc.sweepMode = SweepMode::None;
+        osc.linearStep = 0;
+        osc.logRatio = 1UL << 30;
+        osc.endIncrement = increment;
+        osc.sweepSamplesLeft = 0;
+    }
+
+    // Retune without touching the phase, so the waveform continues without a jump
+    inline void setIncrement(Oscillator &osc, uint64_t increment)
+    {
+        osc.increment = increment;
+        osc.endIncrement = increment;
+        osc.sweepMode = SweepMode::None;
+        osc.sweepSamplesLeft = 0;
+    }
+
+    inline void startLinearSweep(Oscillator &osc, uint64_t startIncrement, uint64_t endIncrement, uint32_t samples)
+    {
+        osc.increment = startIncrement;
+        osc.endIncrement = endIncrement;
+        osc.linearStep = (static_cast<int64_t>(endIncrement) - static_cast<int64_t>(startIncrement)) /
+                         static_cast<int64_t>(samples);
+        osc.sweepSamplesLeft = samples;
+        osc.sweepMode = SweepMode::Linear;
+    }
+
+    // Per-sample multiplier for an exponential sweep, as Q2.30 (setup only).
+    // Both increments must be non-zero; callers check against minFrequency().
+    inline uint32_t logSweepRatio(uint64_t startIncrement, uint64_t endIncrement, uint32_t samples)
+    {
+        if (startIncrement == 0 || endIncrement == 0 || samples == 0)
+        {
+            return 1UL << 30;
+        }
+        double ratio = pow(static_cast<double>(endIncrement) / static_cast<double>(startIncrement), 1.0 / samples);
+        return static_cast<uint32_t>(ratio * (1UL << 30) + 0.5);
+    }
+
+    // The ratio comes from logSweepRatio(), computed before entering any critical section
+    inline void startLogSweep(Oscillator &osc, uint64_t startIncrement, uint64_t endIncrement, uint32_t samples,
+                              uint32_t ratio)
+    {
+        osc.increment = startIncrement;
+        osc.endIncrement = endIncrement;
+        osc.logRatio = ratio;
+        osc.sweepSamplesLeft = samples;
+        osc.sweepMode = SweepMode::Logarithmic;
+    }
+
+    // Q32.32 * Q2.30 without a 128-bit intermediate. The increment stays below
+    // Nyquist (integer part < 2^31) and the ratio below 2.0, so nothing overflows.
+    DDS_ALWAYS_INLINE uint64_t scaleIncrement(uint64_t increment, uint32_t ratio)
+    {
+        uint64_t high = (increment >> 32) * ratio;
+        uint64_t low = (increment & 0xFFFFFFFFULL) * ratio;
+        return (high << 2) + (low >> 30);
+    }
+
+    // Advance one sample. Returns the phase to render for this sample.
+    DDS_ALWAYS_INLINE uint32_t step(Oscillator &osc)
+    {
+        uint32_t phase = osc.phase;
+        osc.phase = phase + static_cast<uint32_t>(osc.increment >> 32);
+
+        if (osc.sweepMode != SweepMode::None)
+        {
+            if (--osc.sweepSamplesLeft == 0)
+            {
+                osc.increment = osc.endIncrement;
+                osc.sweepMode = SweepMode::None;
+            }
+            else if (osc.sweepMode == SweepMode::Linear)
+            {
+                osc.increment += osc.linearStep;
+            }
+            else
+            {
+                osc.increment = scaleIncrement(osc.increment, osc.logRatio);
+            }
+        }
+        return phase;
+    }
+
+    // Map a phase to an index into a power-of-two table with 2^tableBits entries
+    DDS_ALWAYS_INLINE uint32_t tableIndex(uint32_t phase, uint32_t tableBits)
+    {
+        return phase >> (32 - tableBits);
+    }
+}
+
+#endif // DDS_H
@@ -44,7 +44,7 @@ public:
 
     // Status functions
     bool isConnected() const;
-    String getStatusJSON();
+    void populateStatus(JsonObject root);
 
     // Configuration methods
     bool updateConfig(IPAddress newIp, IPAddress newGateway, IPAddress newSubnet, IPAddress newDns);
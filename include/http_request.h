@@ -0,0 +1,77 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ArduinoJson.h>
+#include <esp_http_server.h>
+#include "config.h"
+
+// Body encodings an API client can ask for with the Accept header
+enum class BodyEncoding : uint8_t
+{
+    Json,
+    MessagePack,
+    Cbor
+};
+
+// One request on the esp_http_server task. Offers the part of the Arduino
+// WebServer API the route handlers were written against (hasArg/arg/send/
+// sendHeader/streamFile), so handlers port over with the same behaviour.
+class HttpRequest
+{
+private:
+    static const size_t MAX_HEADERS = 6;
+
+    httpd_req_t *req;
+    String query;
+    String body;
+    bool bodyRead;
+    bool responded;
+    char status[40];
+
+    // esp_http_server keeps pointers to header strings until the response is sent
+    String headerNames[MAX_HEADERS];
+    String headerValues[MAX_HEADERS];
+    size_t headerCount;
+
+    bool readBody();
+    void prepareResponse(int code, const char *contentType);
+
+public:
+    explicit HttpRequest(httpd_req_t *req);
+
+    httpd_req_t *handle() const;
+    String path() const;
+
+    // Query parameters; "plain" is the request body, as with the Arduino WebServer
+    bool hasArg(const char *name);
+    String arg(const char *name);
+    String header(const char *name) const;
+
+    // Raw body access for handlers that consume it incrementally
+    size_t contentLength() const;
+    int receive(uint8_t *buffer, size_t length);
+
+    void sendHeader(const String &name, const String &value);
+    void send(int code, const char *contentType, const String &content);
+    void send(int code, const char *contentType, const uint8_t *content, size_t length);
+
+    // JSON, MessagePack or CBOR depending on Accept. API responses go through
+    // here; text passed to send() above is sent as is.
+    void send(int code, const JsonDocument &doc);
+    BodyEncoding acceptedEncoding() const;
+    bool streamFile(File &file, const char *contentType);
+
+    // Sends only the headers of a text/event-stream response; events are written
+    // to socket() later, after the handler has returned
+    bool beginEventStream();
+    int socket() const;
+    bool hasResponded() const;
+
+    static String urlDecode(const char *encoded);
+    static const char *reasonPhrase(int code);
+    static const char *contentType(BodyEncoding encoding);
+};
+
+#endif // HTTP_REQUEST_H
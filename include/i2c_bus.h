@@ -0,0 +1,88 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Who gets the bus first when several tasks are waiting
+enum class I2CPriority : uint8_t
+{
+    Background, // Scans and probing
+    Normal,     // Periodic sensor sampling
+    High        // Battery gauge and anything the UI is waiting on
+};
+
+// One register read in a batch: length bytes from reg into data
+struct I2CRegisterRead
+{
+    uint8_t reg;
+    uint8_t *data;
+    uint8_t length;
+};
+
+// Owns Wire and arbitrates it between tasks. A client holds the bus for one
+// transaction or one batch of reads; when it is released, the highest
+// priority waiter gets it next (first come first served within a priority).
+// Each holder can ask for its own clock, which is switched only when it differs.
+class I2CBus
+{
+private:
+    struct Waiter
+    {
+        TaskHandle_t task;
+        I2CPriority priority;
+        uint32_t ticket;
+    };
+
+    portMUX_TYPE mux;
+    TaskHandle_t owner;
+    Waiter waiters[I2C_MAX_WAITERS];
+    size_t waiterCount;
+    uint32_t nextTicket;
+    uint32_t currentClock;
+
+    // Statistics, updated while holding the bus
+    uint32_t transactions;
+    uint32_t contended;
+    uint32_t timeouts;
+    uint32_t errors;
+    uint32_t maxWaitUs;
+
+    bool acquire(I2CPriority priority, uint32_t clockHz);
+    void release();
+    void removeWaiter(TaskHandle_t task);
+    bool transfer(uint8_t address, const uint8_t *tx, size_t txLength, uint8_t *rx, size_t rxLength);
+
+public:
+    // Scoped exclusive use of Wire, for drivers that talk to it through a library
+    class Lock
+    {
+    private:
+        I2CBus &bus;
+        bool held;
+
+    public:
+        Lock(I2CBus &bus, I2CPriority priority, uint32_t clockHz = 0);
+        ~Lock();
+        bool isHeld() const;
+        Lock(const Lock &) = delete;
+        Lock &operator=(const Lock &) = delete;
+    };
+
+    I2CBus();
+    void begin();
+
+    // Single transactions; clockHz 0 means I2C_BUS_CLOCK
+    bool probe(uint8_t address, I2CPriority priority, uint32_t clockHz = 0);
+    bool writeRead(uint8_t address, const uint8_t *tx, size_t txLength, uint8_t *rx, size_t rxLength,
+                   I2CPriority priority);
+
+    // Several registers of one device under a single acquisition
+    bool readRegisters(uint8_t address, const I2CRegisterRead *reads, size_t count, I2CPriority priority);
+
+    void populateStats(JsonObject root) const;
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,50 @@
+#ifndef I2C_DEVICES_H
+#define I2C_DEVICES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "i2c_bus.h"
+
+// Registry of known I2C parts, used to name what a scan finds.
+//
+// Several parts can answer at the same address. Those with an ID register are
+// told apart by reading it; the rest are only a guess, in the order listed.
+// The table is a constexpr array in flash, and a result is two bytes.
+namespace i2c_devices
+{
+    const uint8_t UNKNOWN = 0xFF;
+
+    struct Device
+    {
+        uint8_t firstAddress;
+        uint8_t lastAddress;
+        const char *part;
+        const char *kind;
+        bool hasId;             // Reading idRegister, masked, gives idValue
+        uint8_t idRegister;
+        uint8_t idMask;
+        uint8_t idValue;
+        bool writeIsCommand;    // Acts on any byte written to it, so an ID read there is unsafe
+    };
+
+    struct Identity
+    {
+        uint8_t device;         // Registry index, or UNKNOWN
+        bool confirmed;         // Matched by its ID register rather than by address alone
+    };
+
+    // With probe set, the candidates' ID registers are read at background
+    // priority and the first match is confirmed. Failing that, the guess is the
+    // first candidate listed that was not ruled out by its ID register.
+    //
+    // An ID read starts by writing the register number. Where a candidate takes
+    // that byte as a command (a TCA9548A would load it as its channel mask),
+    // nothing is read and the address is named by guess alone, as if probe were
+    // clear.
+    Identity identify(I2CBus &bus, uint8_t address, bool probe);
+
+    // nullptr for UNKNOWN
+    const Device *get(uint8_t index);
+}
+
+#endif // I2C_DEVICES_H
@@ -3,22 +3,68 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include <vector>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "i2c_bus.h"
+#include "i2c_devices.h"
 
+enum class ScanState : uint8_t
+{
+    Idle,
+    Running,
+    Done
+};
+
+struct ScannedDevice
+{
+    uint8_t address;
+    i2c_devices::Identity identity;
+};
+
+// Scans the bus as a background job: startScan() returns at once, a task
+// probes one address after another, and populateStatus() reports progress and
+// the devices found so far while it runs. Probes go through the shared bus at
+// background priority, so battery and sensor reads slip in between them.
 class I2CScanner
 {
 private:
-    bool scanComplete;
-    std::vector<uint8_t> foundAddresses;
+    I2CBus *bus;
+    TaskHandle_t scanTask;
+    mutable portMUX_TYPE stateMux;
+
+    // Shared with the scan task, guarded by stateMux
+    ScanState state;
+    uint32_t jobId;
+    uint32_t clockHz;
+    uint8_t probed;
+    uint8_t deviceCount;
+    uint32_t found[4];            // One bit per 7-bit address
+    bool identifyParts;
+    i2c_devices::Identity identities[I2C_SCAN_MAX_IDENTIFIED]; // In address order
+
+    static void scanLoop(void *arg);
+    void runScan();
 
 public:
-    I2CScanner();
+    I2CScanner(I2CBus *bus);
     void begin();
-    void scan();
-    const std::vector<uint8_t> &getFoundAddresses() const;
-    bool isScanComplete() const;
+
+    // False while a scan is already running. With identify set, devices at
+    // addresses shared by several known parts get their ID registers read.
+    bool startScan(uint32_t busClock = I2C_SCAN_DEFAULT_CLOCK, bool identify = true);
+    ScanState getState() const;
+    bool isFound(uint8_t address) const;
     void clearScanResults();
-    String getJSONResults() const;
+
+    // Id of the last scan that finished, 0 before the first one or while one runs
+    uint32_t getCompletedJob() const;
+
+    // Copies up to capacity devices from the last scan, in address order; returns how many
+    size_t getDevices(ScannedDevice *devices, size_t capacity) const;
+
+    // {"job","state","clockHz","identify","probed","total","scanComplete",
+    //  "devices":[{"address","hexAddress","part","kind","confirmed"}]}
+    void populateStatus(JsonObject root) const;
 };
 
-#endif // I2C_SCANNER_H
\ No newline at end of file
+#endif // I2C_SCANNER_H
@@ -0,0 +1,73 @@
+#ifndef LIVE_STATE_H
+#define LIVE_STATE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "dht_sensor.h"
+#include "dac_control.h"
+#include "battery_manager.h"
+
+// One bit per group of dashboard state
+enum StateField : uint32_t
+{
+    STATE_SENSOR = 1 << 0,
+    STATE_CLIENTS = 1 << 1,
+    STATE_LED = 1 << 2,
+    STATE_DAC = 1 << 3,
+    STATE_BATTERY = 1 << 4,
+    STATE_ALL = 0x1F
+};
+
+const size_t STATE_FIELD_COUNT = 5;
+
+struct StateSnapshot
+{
+    bool sensorReady;
+    float temperature;
+    float humidity;
+    int clients;
+    int led;
+    int dac;
+    bool batteryConnected;
+    float batteryVoltage;
+    float batteryPercent;
+    bool usbPowered;
+    bool charging;
+};
+
+// The dashboard state in one place. refresh() re-reads every source and
+// reports which groups changed, so pushers only send deltas.
+class LiveState
+{
+private:
+    DHTSensor *dhtSensor;
+    DACControl *dacControl;
+    BatteryManager *batteryManager;
+
+    StateSnapshot current;
+    uint32_t version;             // Bumped whenever any group changes
+    uint32_t fieldVersions[STATE_FIELD_COUNT]; // Version at which each group last changed
+    unsigned long lastBatteryRead;
+
+    void readBattery(StateSnapshot &next);
+
+public:
+    LiveState(DHTSensor *dhtSensor, DACControl *dacControl, BatteryManager *batteryManager);
+
+    // Returns the StateField mask of groups that changed since the last call
+    uint32_t refresh();
+    uint32_t getVersion() const;
+    const StateSnapshot &getSnapshot() const;
+
+    // Groups that changed after the given version; all of them if it is from before a reboot
+    uint32_t changedSince(uint32_t since) const;
+
+    // "sensor,dac" -> STATE_SENSOR | STATE_DAC; false on an unknown name
+    static bool parseFields(const String &list, uint32_t &fields);
+
+    // Adds the selected groups to root, in the same shape as the REST endpoints
+    void toJSON(JsonObject root, uint32_t fields) const;
+};
+
+#endif // LIVE_STATE_H
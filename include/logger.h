@@ -0,0 +1,76 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+#include "config.h"
+
+enum class LogLevel : uint8_t
+{
+    Error,
+    Warn,
+    Info,
+    Debug
+};
+
+// Levels above this are compiled out entirely, e.g. -D LOG_MAX_LEVEL=2 drops Debug
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL 3
+#endif
+
+// Leveled logging that never blocks the caller. A line is formatted on the
+// caller's stack, copied into a ring buffer and written to Serial by a task
+// below loop() and the web server. When the buffer is full the line is
+// dropped and counted instead. Safe from any task, but not from an ISR.
+class Logger
+{
+private:
+    RingbufHandle_t buffer;
+    TaskHandle_t drainTask;
+    std::atomic<LogLevel> level;
+    std::atomic<uint32_t> written;
+    std::atomic<uint32_t> dropped;
+
+    static void drainLoop(void *arg);
+
+public:
+    Logger();
+    void begin();
+
+    void setLevel(LogLevel newLevel);
+    LogLevel getLevel() const;
+
+    // Checked by the LOG_* macros before any formatting happens
+    bool isEnabled(LogLevel messageLevel) const
+    {
+        return messageLevel <= level.load(std::memory_order_relaxed);
+    }
+
+    // "[tag] message\n"
+    void log(LogLevel messageLevel, const char *tag, const char *format, ...) __attribute__((format(printf, 4, 5)));
+    void populateStats(JsonObject root) const;
+
+    static bool parseLevel(const String &name, LogLevel &level);
+    static const char *levelName(LogLevel level);
+};
+
+extern Logger logger;
+
+#define LOG_AT(messageLevel, tag, ...)                                                            \
+    do                                                                                            \
+    {                                                                                             \
+        if (static_cast<int>(messageLevel) <= LOG_MAX_LEVEL && logger.isEnabled(messageLevel))   \
+        {                                                                                         \
+            logger.log(messageLevel, tag, __VA_ARGS__);                                           \
+        }                                                                                         \
+    } while (0)
+
+#define LOG_ERROR(tag, ...) LOG_AT(LogLevel::Error, tag, __VA_ARGS__)
+#define LOG_WARN(tag, ...) LOG_AT(LogLevel::Warn, tag, __VA_ARGS__)
+#define LOG_INFO(tag, ...) LOG_AT(LogLevel::Info, tag, __VA_ARGS__)
+#define LOG_DEBUG(tag, ...) LOG_AT(LogLevel::Debug, tag, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -0,0 +1,85 @@
+#ifndef SAMPLE_RING_BUFFER_H
+#define SAMPLE_RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Preallocated single-producer/single-consumer ring of 8-bit DAC samples.
+//
+// The web handler writes, the DAC sample ISR reads. Head and tail are only
+// ever written by one side each, so plain atomic loads/stores are enough and
+// neither side has to take a lock. Capacity must be a power of two.
+template <size_t Capacity>
+class SampleRingBuffer
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    uint8_t data[Capacity];
+    std::atomic<uint32_t> head; // Next write position (producer)
+    std::atomic<uint32_t> tail; // Next read position (consumer)
+
+public:
+    SampleRingBuffer() : head(0), tail(0) {}
+
+    // Only call while no consumer is running
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    size_t freeSpace() const
+    {
+        return Capacity - size();
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+    // Producer side: copy as many samples as fit, returns the number written
+    size_t write(const uint8_t *samples, size_t count)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        size_t space = Capacity - (h - tail.load(std::memory_order_acquire));
+        if (count > space)
+        {
+            count = space;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            data[(h + i) & (Capacity - 1)] = samples[i];
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side, ISR safe
+    inline __attribute__((always_inline)) bool pop(uint8_t &sample)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        sample = data[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Random access relative to the read position, for looped playback that never consumes
+    inline __attribute__((always_inline)) uint8_t at(uint32_t index) const
+    {
+        return data[(tail.load(std::memory_order_relaxed) + index) & (Capacity - 1)];
+    }
+};
+
+#endif // SAMPLE_RING_BUFFER_H
@@ -0,0 +1,42 @@
+#ifndef SENSOR_DRIVER_H
+#define SENSOR_DRIVER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "i2c_bus.h"
+
+// One reading from a sample; name and unit point at string literals
+struct SensorValue
+{
+    const char *name;
+    const char *unit;
+    float value;
+};
+
+// Driver for one I2C part at one address. begin() checks the part and sets it
+// up; sample() should fetch everything it reports in a single readRegisters()
+// batch, so each sample holds the bus once. Drivers run only on the sensor task.
+class SensorDriver
+{
+protected:
+    I2CBus *bus;
+    uint8_t address;
+
+    bool writeRegister(uint8_t reg, uint8_t value);
+    virtual bool configure() = 0;
+
+public:
+    SensorDriver();
+    virtual ~SensorDriver() {}
+
+    bool begin(I2CBus *bus, uint8_t address);
+
+    // Fills values and returns how many, or 0 if the read failed
+    virtual size_t sample(SensorValue *values) = 0;
+};
+
+// A new driver for a registry part name, with the rate it should be sampled
+// at, or nullptr if no driver handles that part
+SensorDriver *createSensorDriver(const char *part, uint32_t &intervalMs);
+
+#endif // SENSOR_DRIVER_H
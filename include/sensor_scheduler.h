@@ -0,0 +1,64 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "i2c_bus.h"
+#include "i2c_scanner.h"
+#include "sensor_driver.h"
+
+// Attaches a driver to every device the last scan identified as a part with
+// one, and samples each on its own task at the driver's rate. Devices are
+// staggered by SENSOR_TICK_MS so ones with the same rate do not hit the bus
+// together. Results land in a snapshot table that the API reads without
+// touching the bus.
+class SensorScheduler
+{
+private:
+    // What the API sees of a slot, copied out under mux
+    struct Snapshot
+    {
+        uint8_t address;
+        const char *part;
+        uint32_t intervalMs;
+        SensorValue values[SENSOR_MAX_VALUES];
+        uint8_t valueCount;
+        bool ok;
+        unsigned long sampledAt;
+        uint32_t samples;
+        uint32_t failures;
+    };
+
+    struct Slot
+    {
+        // Sensor task only
+        SensorDriver *driver;
+        unsigned long nextDue;
+
+        // Guarded by mux
+        Snapshot snapshot;
+    };
+
+    I2CBus *bus;
+    I2CScanner *scanner;
+    TaskHandle_t task;
+    mutable portMUX_TYPE mux;
+    Slot slots[SENSOR_MAX_DEVICES];
+    size_t slotCount;
+    uint32_t attachedJob;
+
+    static void sampleLoop(void *arg);
+    void attach();
+    void detach(size_t index);
+    void sampleDue(unsigned long now);
+
+public:
+    SensorScheduler(I2CBus *bus, I2CScanner *scanner);
+    void begin();
+
+    // One entry per attached device: address, part, rate, age and its readings
+    void populateSensors(JsonArray &sensors) const;
+};
+
+#endif // SENSOR_SCHEDULER_H
@@ -0,0 +1,61 @@
+#ifndef SEQUENCE_PLAYER_H
+#define SEQUENCE_PLAYER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "dac_control.h"
+
+struct SequenceStep
+{
+    uint32_t offsetUs; // Time from the start of the cycle
+    uint8_t dacValue;
+    uint8_t ledState;
+};
+
+// Replays a preloaded (time, DAC, LED) program from a hardware timer ISR and
+// records how far each step landed from its scheduled time.
+class SequencePlayer
+{
+private:
+    DACControl *dacControl;
+    hw_timer_t *timer;
+    portMUX_TYPE timerMux;
+
+    SequenceStep steps[MAX_SEQUENCE_STEPS];
+    size_t stepCount;
+    bool loop;
+    uint32_t periodUs;            // Cycle length when looping
+
+    // Playback state, shared with the ISR
+    volatile bool running;
+    volatile size_t nextStep;
+    volatile uint64_t cycleStartUs;
+    volatile uint32_t cyclesCompleted;
+
+    // Jitter statistics: deviation of actual from scheduled time, in microseconds
+    int32_t deviationHistory[SEQUENCE_JITTER_HISTORY];
+    volatile uint32_t deviationCount;
+    volatile int32_t minDeviation;
+    volatile int32_t maxDeviation;
+
+    static SequencePlayer *instance;
+    static void IRAM_ATTR onTimer();
+    void IRAM_ATTR serviceTimer();
+    static void IRAM_ATTR onTrigger(void *context);
+    void IRAM_ATTR startFromISR();
+    void resetStatistics();
+
+public:
+    SequencePlayer(DACControl *dacControl);
+    void begin();
+
+    // Load a program from {"steps":[[offsetUs,dac,led],...],"loop":bool,"periodUs":n}
+    bool loadJSON(const String &json, String &error);
+    bool start();
+    void stop();
+    bool isRunning() const;
+    void populateStatus(JsonObject root) const;
+};
+
+#endif // SEQUENCE_PLAYER_H
@@ -0,0 +1,60 @@
+#ifndef SETPOINT_MAILBOX_H
+#define SETPOINT_MAILBOX_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Single-slot, latest-wins mailbox for DAC setpoints.
+//
+// Producers (web handlers) overwrite the slot; the consumer takes whatever is
+// there at its own pace. Intermediate values that were never taken are simply
+// replaced and counted as coalesced, so a fast producer can never queue up work.
+class SetpointMailbox
+{
+private:
+    static constexpr int32_t EMPTY = -1;
+
+    std::atomic<int32_t> slot;
+    std::atomic<uint32_t> postedCount;
+    std::atomic<uint32_t> coalescedCount;
+
+public:
+    SetpointMailbox() : slot(EMPTY), postedCount(0), coalescedCount(0) {}
+
+    // Store a new setpoint (values must be >= 0), replacing any unread one
+    void post(int32_t value)
+    {
+        if (slot.exchange(value, std::memory_order_acq_rel) != EMPTY)
+        {
+            coalescedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        postedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Take the latest setpoint if one arrived since the last call
+    bool take(int32_t &value)
+    {
+        int32_t latest = slot.exchange(EMPTY, std::memory_order_acq_rel);
+        if (latest == EMPTY)
+        {
+            return false;
+        }
+        value = latest;
+        return true;
+    }
+
+    // Drop an unread setpoint, e.g. because another output has just taken over;
+    // it counts as coalesced since it never reached the DAC
+    void discard()
+    {
+        if (slot.exchange(EMPTY, std::memory_order_acq_rel) != EMPTY)
+        {
+            coalescedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t getPostedCount() const { return postedCount.load(std::memory_order_relaxed); }
+    uint32_t getCoalescedCount() const { return coalescedCount.load(std::memory_order_relaxed); }
+};
+
+#endif // SETPOINT_MAILBOX_H
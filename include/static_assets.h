@@ -0,0 +1,45 @@
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include <Arduino.h>
+#include <vector>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// A file from the generated web image: stored as <path>.gz, identified by a content hash
+struct StaticAsset
+{
+    String path;
+    String etag;    // Quoted, ready for the ETag header
+    bool immutable; // Referenced with ?v=<hash>, so it may be cached indefinitely
+
+    // RAM copy of the gzipped file, loaded on first use while the budget allows
+    uint8_t *data;
+    size_t size;
+    bool uncacheable; // Too large, or did not fit when it was first requested
+};
+
+// The asset manifest (/assets.json) written by scripts/build_web_assets.py,
+// plus an in-RAM cache of the files it lists. Only used from the server task.
+class StaticAssets
+{
+private:
+    std::vector<StaticAsset> assets; // Sorted by path for binary search
+    size_t bytesCached;
+    uint32_t hits;
+    uint32_t misses;
+
+public:
+    StaticAssets();
+    ~StaticAssets();
+    bool begin();
+    StaticAsset *find(const String &path);
+    size_t count() const;
+
+    // The cached bytes of <path>.gz, loading them if they fit; nullptr means stream from flash
+    const uint8_t *getCachedData(StaticAsset &asset);
+
+    void populateStats(JsonObject root) const;
+};
+
+#endif // STATIC_ASSETS_H
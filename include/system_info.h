@@ -26,6 +26,7 @@ public:
   String getCompleteSystemInfoJSON();
   
   // Populate JSON objects directly
+  void populateSystemInfo(JsonObject& root); // Same document as getCompleteSystemInfoJSON()
   void populateNetworkInfo(JsonObject& network);
   void populateResourceInfo(JsonObject& resources);
   void populateBoardInfo(JsonObject& board);
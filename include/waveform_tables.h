@@ -0,0 +1,102 @@
+#ifndef WAVEFORM_TABLES_H
+#define WAVEFORM_TABLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Number of samples in one period of every built-in waveform (must be a power of two)
+constexpr size_t WAVE_TABLE_SIZE = 256;
+constexpr uint32_t WAVE_TABLE_BITS = 8;
+
+enum class Waveform : uint8_t
+{
+    Sine,
+    Triangle,
+    Sawtooth,
+    Square
+};
+
+// Signed unit waveforms (-127..127), generated at compile time and kept in flash.
+// The DAC engine scales them into a RAM buffer before playback, so the sample ISR
+// never has to touch flash.
+namespace wavetable
+{
+    struct Table
+    {
+        int8_t samples[WAVE_TABLE_SIZE];
+    };
+
+    constexpr double PI_CONST = 3.14159265358979323846;
+
+    // Sine usable in constant expressions: range-reduce to [-pi, pi], then Taylor series
+    constexpr double sinApprox(double x)
+    {
+        while (x > PI_CONST)
+            x -= 2.0 * PI_CONST;
+        while (x < -PI_CONST)
+            x += 2.0 * PI_CONST;
+
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 12; n++)
+        {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr int8_t toSample(double unit)
+    {
+        return static_cast<int8_t>(unit >= 0.0 ? unit * 127.0 + 0.5 : unit * 127.0 - 0.5);
+    }
+
+    constexpr Table makeTable(Waveform shape)
+    {
+        Table table{};
+        for (size_t i = 0; i < WAVE_TABLE_SIZE; i++)
+        {
+            double phase = static_cast<double>(i) / WAVE_TABLE_SIZE; // 0..1
+            double unit = 0.0;
+
+            switch (shape)
+            {
+            case Waveform::Sine:
+                unit = sinApprox(2.0 * PI_CONST * phase);
+                break;
+            case Waveform::Triangle:
+                unit = phase < 0.25 ? 4.0 * phase
+                     : phase < 0.75 ? 2.0 - 4.0 * phase
+                                    : 4.0 * phase - 4.0;
+                break;
+            case Waveform::Sawtooth:
+                unit = 2.0 * phase - 1.0;
+                break;
+            case Waveform::Square:
+                unit = phase < 0.5 ? 1.0 : -1.0;
+                break;
+            }
+            table.samples[i] = toSample(unit);
+        }
+        return table;
+    }
+
+    constexpr Table SINE = makeTable(Waveform::Sine);
+    constexpr Table TRIANGLE = makeTable(Waveform::Triangle);
+    constexpr Table SAWTOOTH = makeTable(Waveform::Sawtooth);
+    constexpr Table SQUARE = makeTable(Waveform::Square);
+
+    static_assert(WAVE_TABLE_SIZE == (1u << WAVE_TABLE_BITS), "WAVE_TABLE_SIZE must be 2^WAVE_TABLE_BITS");
+    static_assert(SINE.samples[WAVE_TABLE_SIZE / 4] == 127, "sine table peak");
+    static_assert(SINE.samples[3 * WAVE_TABLE_SIZE / 4] == -127, "sine table trough");
+
+    constexpr const Table &forShape(Waveform shape)
+    {
+        return shape == Waveform::Sine       ? SINE
+             : shape == Waveform::Triangle   ? TRIANGLE
+             : shape == Waveform::Sawtooth   ? SAWTOOTH
+                                             : SQUARE;
+    }
+}
+
+#endif // WAVEFORM_TABLES_H
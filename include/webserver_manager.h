@@ -3,53 +3,192 @@
 
 #include <Arduino.h>
 // #include "ethernet_controller.h"
-#include <WebServer.h> // Make sure this include is present
+#include <esp_http_server.h>
 #include <SPIFFS.h>
+#include "http_request.h"
 #include "dht_sensor.h"
 #include "dac_control.h"
+#include "i2c_bus.h"
 #include "i2c_scanner.h"
+#include "sensor_scheduler.h"
 #include "system_info.h"
 #include "battery_manager.h"
+#include "sequence_player.h"
+#include "dac_feedback.h"
+#include "live_state.h"
+#include "static_assets.h"
 
 class EthernetController;
 
 class WebServerManager
 {
 private:
-    WebServer server;
+    typedef void (WebServerManager::*RouteHandler)(HttpRequest &request);
+
+    // One entry of the compile-time route table; contentType is what the route
+    // answers with, for the /debug listing. A selfLocking handler is called
+    // without controlMutex and takes it only around its own DAC calls.
+    struct Route
+    {
+        const char *path;
+        httpd_method_t method;
+        RouteHandler handler;
+        const char *contentType;
+        bool selfLocking = false;
+    };
+
+    struct RouteTable
+    {
+        const Route *routes;
+        size_t count;
+    };
+
+    // A text/event-stream client and when its next snapshot is due
+    struct EventSubscriber
+    {
+        int socket;
+        uint32_t intervalMs;
+        unsigned long nextDue;
+    };
+
+    // Session context of every open connection, for keep-alive bookkeeping
+    struct ConnectionState
+    {
+        unsigned long lastActive;
+        uint32_t requests;
+    };
+
+    httpd_handle_t server;
+    int port;
+    SemaphoreHandle_t controlMutex;
+    StaticAssets staticAssets;
     DHTSensor *dhtSensor;
     DACControl *dacControl;
     I2CScanner *i2cScanner;
+    I2CBus *i2cBus;
+    SensorScheduler *sensorScheduler;
     SystemInfo *systemInfo;
     BatteryManager *batteryManager;
+    SequencePlayer *sequencePlayer;
+    DacFeedbackLoop *feedbackLoop;
+    LiveState *liveState;
     EthernetController *ethernetController;
+    unsigned long lastStatePublish;
+    uint32_t publishedVersion;    // LiveState version last pushed to WebSocket clients
+
+    // SSE subscribers, only touched on the server task
+    EventSubscriber subscribers[SSE_MAX_SUBSCRIBERS];
+    volatile size_t subscriberCount;
+    unsigned long lastEventTick;
+
+    // Keep-alive pool, only touched on the server task
+    unsigned long lastIdleSweep;
+    uint32_t connectionsOpened;
+    uint32_t requestsServed;
+    uint32_t idleClosed;
+    uint32_t limitClosed;
+
+    // State of the waveform upload in progress
+    bool streamFormat16;
+    bool streamHasCarry;
+    int streamUploadStatus;        // HTTP status the upload will be answered with
+    const char *streamUploadError;
 
     // Private handler methods
-    void handleRoot();
-    void handleCSS();
-    void handleJavaScriptFile(const String &filename);
-    void handleLED();
-    void handleLEDState();
-    void handleDAC();
-    void handleDACState();
-    void handleClients();
-    void handleSensor();
-    void handleScan();
-    void handleSystemInfo();
-    void handleEthernetStatus();
-    void handleEthernetConfig();
-    void handleDebug();
+    void handleRoot(HttpRequest &request);
+    void handleAssetStats(HttpRequest &request);
+    void handleCSS(HttpRequest &request);
+    void handleJavaScriptFile(HttpRequest &request);
+    void handleLED(HttpRequest &request);
+    void handleLEDState(HttpRequest &request);
+    void handleDAC(HttpRequest &request);
+    void handleDACState(HttpRequest &request);
+    void handleDACStats(HttpRequest &request);
+    void handleDACVoltage(HttpRequest &request);
+    void handleCalibration(HttpRequest &request);
+    void handleCalibrationSave(HttpRequest &request);
+    void handleDACRamp(HttpRequest &request);
+    void handleFeedbackLoop(HttpRequest &request);
+    void handleStreamUpload(HttpRequest &request);
+    void handleStreamComplete(HttpRequest &request);
+    void failStreamUpload(int status, const char *error);
+    void takeDacOutput();
+    void handleStreamStatus(HttpRequest &request);
+    void handleSequenceLoad(HttpRequest &request);
+    void handleSequenceStatus(HttpRequest &request);
+    void handleSequenceStart(HttpRequest &request);
+    void handleSequenceStop(HttpRequest &request);
+    void handleTrigger(HttpRequest &request);
+    void handleWaveform(HttpRequest &request);
+    void handleWaveformStop(HttpRequest &request);
+    void handleGenerator(HttpRequest &request);
+    void handleDDS(HttpRequest &request);
+    void handleSweep(HttpRequest &request);
+    void handleClients(HttpRequest &request);
+    void handleSensor(HttpRequest &request);
+    void handleScan(HttpRequest &request);
+    void handleScanStatus(HttpRequest &request);
+    void handleI2CBus(HttpRequest &request);
+    void handleSystemInfo(HttpRequest &request);
+    void handleEvents(HttpRequest &request);
+    void handleApiState(HttpRequest &request);
+    void handleApiSensors(HttpRequest &request);
+    void handleLog(HttpRequest &request);
+    void handleEthernetStatus(HttpRequest &request);
+    void handleEthernetConfig(HttpRequest &request);
+    void handleDebug(HttpRequest &request);
 
     // Helper method to serve files
-    void serveFile(const String &path, const String &contentType);
+    void serveFile(HttpRequest &request, const String &path, const char *contentType);
+
+    // Every request goes through dispatch, which binary-searches the sorted route table
+    static RouteTable routeTable();
+    static const Route *findRoute(const char *uri, httpd_method_t method, bool &pathKnown);
+    static esp_err_t dispatch(httpd_req_t *req);
+
+    // WebSocket push channel (/ws)
+    static esp_err_t handleWebSocket(httpd_req_t *req);
+    static void sendBroadcast(void *arg);
+    void handleWebSocketCommand(const char *message);
+    void stateDocument(JsonDocument &doc, uint32_t fields);
+    String stateMessage(uint32_t fields);
+    uint32_t refreshState();
+    void broadcast(const String &message);
+
+    // Server-Sent Events telemetry stream (/events)
+    static WebServerManager *instance;
+    static void sendEvents(void *arg);
+    static void onSocketClose(httpd_handle_t handle, int socket);
+    String eventMessage();
+    void removeSubscriber(int socket);
+    bool isSubscriber(int socket) const;
+
+    // Persistent connections: idle timeout and per-connection request limit
+    static esp_err_t onSocketOpen(httpd_handle_t handle, int socket);
+    static void freeConnection(void *context);
+    static void closeIdleConnections(void *arg);
 
 public:
     WebServerManager(int port, DHTSensor *dhtSensor, DACControl *dacControl,
-                     I2CScanner *i2cScanner, SystemInfo *systemInfo,
-                     BatteryManager *batteryManager,
+                     I2CScanner *i2cScanner, I2CBus *i2cBus, SensorScheduler *sensorScheduler,
+                     SystemInfo *systemInfo,
+                     BatteryManager *batteryManager, SequencePlayer *sequencePlayer,
+                     DacFeedbackLoop *feedbackLoop, LiveState *liveState,
                      EthernetController *ethernetController = nullptr);
     void begin();
-    void handleClient();
+
+    // Held by every route handler; loop() takes it before touching shared objects
+    bool tryLockControl();
+    void unlockControl();
+
+    // Called from loop(): detects state changes and pushes them to WebSocket clients
+    void publishState();
+
+    // Called from loop(): paces the SSE telemetry ticks
+    void publishEvents();
+
+    // Called from loop(): closes keep-alive connections that have gone quiet
+    void sweepConnections();
 };
 
 #endif // WEBSERVER_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+# Measures API requests/s against the board with and without HTTP keep-alive.
+#
+# "close" opens a new TCP connection for every request, as the UI did before
+# the server kept connections open; "keep-alive" sends every request over one
+# persistent connection. The server closes a connection after
+# HTTP_MAX_KEEPALIVE_REQUESTS requests, so the keep-alive run reconnects when
+# it is told to.
+#
+#   python scripts/bench_keepalive.py [host] [--path /api/state] [--requests 500]
+#
+# Board numbers are still to be taken: so far the script has only been run
+# against a server on the development machine, which says nothing about the
+# ESP32-S2's TCP setup cost. Record the close vs keep-alive results here once
+# it has been run against the board.
+
+import argparse
+import http.client
+import statistics
+import time
+
+
+def run(host, port, path, requests, keep_alive):
+    latencies = []
+    connection = None
+    reconnects = 0
+
+    start = time.perf_counter()
+    for _ in range(requests):
+        if connection is None:
+            connection = http.client.HTTPConnection(host, port, timeout=10)
+            reconnects += 1
+
+        began = time.perf_counter()
+        headers = {} if keep_alive else {"Connection": "close"}
+        connection.request("GET", path, headers=headers)
+        response = connection.getresponse()
+        response.read()
+        latencies.append(time.perf_counter() - began)
+
+        if not keep_alive or response.getheader("Connection", "").lower() == "close":
+            connection.close()
+            connection = None
+    elapsed = time.perf_counter() - start
+
+    if connection is not None:
+        connection.close()
+
+    latencies.sort()
+    return {
+        "rate": requests / elapsed,
+        "median": statistics.median(latencies) * 1000,
+        "p95": latencies[int(len(latencies) * 0.95) - 1] * 1000,
+        "connections": reconnects,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="API requests/s with and without keep-alive")
+    parser.add_argument("host", nargs="?", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/api/state")
+    parser.add_argument("--requests", type=int, default=500)
+    args = parser.parse_args()
+
+    print("GET http://%s:%d%s, %d requests per run" % (args.host, args.port, args.path, args.requests))
+    results = {}
+    for name, keep_alive in (("close", False), ("keep-alive", True)):
+        result = run(args.host, args.port, args.path, args.requests, keep_alive)
+        results[name] = result
+        print("%-10s  %7.1f req/s  median %6.1f ms  p95 %6.1f ms  %d connections" %
+              (name, result["rate"], result["median"], result["p95"], result["connections"]))
+
+    print("keep-alive speedup: %.1fx" % (results["keep-alive"]["rate"] / results["close"]["rate"]))
+
+
+if __name__ == "__main__":
+    main()
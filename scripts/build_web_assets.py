@@ -0,0 +1,202 @@
+# PlatformIO pre-build step: turns data/ into the filesystem image contents.
+#
+# Release builds bundle the local <script> modules of index.html, in page
+# order, into one minified app.js and inline style.css, so a first visit
+# needs two requests instead of nine. Builds with -D WEB_DEBUG_ASSETS keep
+# the individual, unminified files for debugging in the browser.
+#
+# Every asset is then gzipped, and a manifest (/assets.json) records a
+# content hash per file that the web server uses as ETag. index.html
+# references the other assets with ?v=<hash>, so they can be cached for a
+# year and index.html only ever needs a revalidation (304) on a revisit.
+#
+# Also runs standalone:
+#   python scripts/build_web_assets.py [source] [output] [--debug]
+
+import gzip
+import hashlib
+import json
+import os
+import re
+import shutil
+import sys
+
+INDEX = "index.html"
+BUNDLE = "app.js"
+STYLESHEET = "style.css"
+
+SCRIPT_TAG = re.compile(r'[ \t]*<script src="([^"?#:]+\.js)"></script>\n?')
+STYLESHEET_TAG = re.compile(r'<link rel="stylesheet" href="%s">' % re.escape(STYLESHEET))
+
+# A '/' after one of these (or at the start of a line) begins a regex literal, not a division
+REGEX_PRECEDERS = set("(,=:[!&|?{};+-*%<>~^")
+
+
+def minify_js(source):
+    """Conservative minifier: drops comments, indentation and blank lines.
+
+    Line breaks are kept so automatic semicolon insertion behaves exactly as
+    in the original source. Strings, template literals and regex literals
+    are copied verbatim.
+    """
+    out = []
+    last = None  # Last character emitted other than a space or tab
+    i = 0
+    n = len(source)
+    while i < n:
+        if out and out[-1].rstrip(" \t"):
+            last = out[-1].rstrip(" \t")[-1]
+        c = source[i]
+        nxt = source[i + 1] if i + 1 < n else ""
+
+        if c in "'\"`":
+            j = i + 1
+            while j < n and source[j] != c:
+                j += 2 if source[j] == "\\" else 1
+            out.append(source[i:j + 1])
+            i = j + 1
+        elif c == "/" and nxt == "/":
+            while i < n and source[i] != "\n":
+                i += 1
+        elif c == "/" and nxt == "*":
+            end = source.find("*/", i + 2)
+            i = n if end < 0 else end + 2
+        elif c == "/" and (last is None or last in REGEX_PRECEDERS or last == "\n"):
+            j = i + 1
+            in_class = False
+            while j < n and (in_class or source[j] != "/"):
+                if source[j] == "\\":
+                    j += 1
+                elif source[j] == "[":
+                    in_class = True
+                elif source[j] == "]":
+                    in_class = False
+                j += 1
+            j += 1
+            while j < n and source[j].isalpha():  # flags
+                j += 1
+            out.append(source[i:j])
+            i = j
+        else:
+            out.append(c)
+            i += 1
+
+    lines = (line.strip() for line in "".join(out).split("\n"))
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def minify_css(source):
+    source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+    source = re.sub(r"\s+", " ", source)
+    source = re.sub(r"\s*([{};,>])\s*", r"\1", source)
+    return source.replace(";}", "}").strip()
+
+
+def minify_html(source):
+    source = re.sub(r"<!--.*?-->", "", source, flags=re.S)
+    lines = (line.strip() for line in source.split("\n"))
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def bundle(assets):
+    """Replaces the module scripts and stylesheet of index.html with app.js and an inline <style>."""
+    index = assets[INDEX].decode("utf-8")
+    modules = [name for name in SCRIPT_TAG.findall(index) if name in assets]
+    if not modules:
+        return
+
+    parts = []
+    for name in modules:
+        parts.append("// %s\n%s" % (name, assets.pop(name).decode("utf-8")))
+    assets[BUNDLE] = minify_js("\n;\n".join(parts)).encode("utf-8")
+
+    # The bundle goes where the first module was, so it still loads before the page body
+    first = [True]
+
+    def replace(match):
+        if match.group(1) not in modules:
+            return match.group(0)
+        if first[0]:
+            first[0] = False
+            return '  <script src="%s"></script>\n' % BUNDLE
+        return ""
+
+    index = SCRIPT_TAG.sub(replace, index)
+    if STYLESHEET in assets:
+        css = minify_css(assets.pop(STYLESHEET).decode("utf-8"))
+        index = STYLESHEET_TAG.sub(lambda match: "<style>%s</style>" % css, index)
+    assets[INDEX] = minify_html(index).encode("utf-8")
+
+
+def content_hash(data):
+    return hashlib.sha1(data).hexdigest()[:12]
+
+
+def version_references(index, hashes):
+    # src="x.js" / href="x.css" -> src="x.js?v=<hash>" for every asset we know
+    def replace(match):
+        name = match.group(2)
+        if name not in hashes:
+            return match.group(0)
+        return '%s="%s?v=%s"' % (match.group(1), name, hashes[name])
+
+    return re.sub(r'(src|href)="([^"?#:]+)"', replace, index)
+
+
+def build(source, output, debug=False):
+    if os.path.isdir(output):
+        shutil.rmtree(output)
+    os.makedirs(output)
+
+    assets = {}
+    for name in sorted(os.listdir(source)):
+        path = os.path.join(source, name)
+        if os.path.isfile(path) and not name.startswith("."):
+            with open(path, "rb") as f:
+                assets[name] = f.read()
+
+    if not debug and INDEX in assets:
+        bundle(assets)
+
+    hashes = {name: content_hash(data) for name, data in assets.items() if name != INDEX}
+    if INDEX in assets:
+        assets[INDEX] = version_references(assets[INDEX].decode("utf-8"), hashes).encode("utf-8")
+
+    manifest = {}
+    raw_total = 0
+    gzip_total = 0
+    for name, data in assets.items():
+        # mtime=0 keeps the output byte-identical between builds
+        compressed = gzip.compress(data, compresslevel=9, mtime=0)
+        with open(os.path.join(output, name + ".gz"), "wb") as f:
+            f.write(compressed)
+
+        manifest["/" + name] = {
+            "etag": content_hash(data),
+            # Only index.html is fetched by its bare name; everything else is versioned
+            "immutable": name != INDEX,
+        }
+        raw_total += len(data)
+        gzip_total += len(compressed)
+
+    with open(os.path.join(output, "assets.json"), "w") as f:
+        json.dump(manifest, f, separators=(",", ":"), sort_keys=True)
+
+    print("Web assets (%s): %d files, %d bytes -> %d bytes gzipped" %
+          ("debug" if debug else "bundled", len(assets), raw_total, gzip_total))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    flags = env.GetProjectOption("build_flags", "")  # noqa: F821
+    if isinstance(flags, (list, tuple)):
+        flags = " ".join(flags)
+    build(os.path.join(env.subst("$PROJECT_DIR"), "data"), env.subst("$PROJECT_DATA_DIR"),  # noqa: F821
+          debug="WEB_DEBUG_ASSETS" in flags)
+except NameError:
+    if __name__ == "__main__":
+        here = os.path.dirname(os.path.abspath(__file__))
+        args = [arg for arg in sys.argv[1:] if arg != "--debug"]
+        build(args[0] if len(args) > 0 else os.path.join(here, "..", "data"),
+              args[1] if len(args) > 1 else os.path.join(here, "..", ".pio", "webdata"),
+              debug="--debug" in sys.argv)
@@ -1,9 +1,15 @@
 // battery_manager.cpp
 #include <Arduino.h>
 #include "battery_manager.h"
+#include "logger.h"
 
 
-BatteryManager::BatteryManager() : 
+BatteryManager::BatteryManager(I2CBus* bus) : 
+  bus(bus),
+  cachedVoltage(0),
+  cachedPercent(0),
+  sampleTime(0),
+  sampleValid(false),
   lastVoltage(0),
   lastCheckTime(0),
   lastPowerState(false),
@@ -12,14 +18,17 @@ BatteryManager::BatteryManager() :
 }
 
 bool BatteryManager::begin() {
+  // The library talks to Wire directly, so hold the bus for the whole setup
+  I2CBus::Lock lock(*bus, I2CPriority::High);
+  
   // Try to initialize the LC709203F battery monitor
-  if (!lc.begin()) {
-    Serial.println("Couldn't find LC709203F battery monitor");
+  if (!lock.isHeld() || !lc.begin()) {
+    LOG_WARN("Battery", "Couldn't find LC709203F battery monitor");
     monitorAvailable = false;
     return false;
   }
   
-  Serial.println("Found LC709203F battery monitor");
+  LOG_INFO("Battery", "Found LC709203F battery monitor");
   monitorAvailable = true;
   
   // Set up the LC709203F
@@ -29,21 +38,30 @@ bool BatteryManager::begin() {
   return true;
 }
 
-bool BatteryManager::isConnected() {
+bool BatteryManager::sample() {
   if (!monitorAvailable) return false;
+  if (sampleValid && millis() - sampleTime < BATTERY_SAMPLE_MAX_AGE) return true;
+  
+  I2CBus::Lock lock(*bus, I2CPriority::High);
+  if (!lock.isHeld()) {
+    // Bus busy past the lock timeout; a stale sample is better than none
+    return sampleValid;
+  }
   
-  // Get the voltage from the LC709203F
-  float cellVoltage = lc.cellVoltage();
+  cachedVoltage = lc.cellVoltage();
+  cachedPercent = lc.cellPercent();
+  sampleTime = millis();
+  sampleValid = true;
   
-  // Get the percentage - an additional check
-  float cellPercent = lc.cellPercent();
+  LOG_DEBUG("Battery", "Battery voltage: %.2fV, percentage: %.1f%%", cachedVoltage, cachedPercent);
+  return true;
+}
+
+bool BatteryManager::isConnected() {
+  if (!sample()) return false;
   
-  // Print debug info to serial
-  Serial.print("Battery voltage: ");
-  Serial.print(cellVoltage);
-  Serial.print("V, percentage: ");
-  Serial.print(cellPercent);
-  Serial.println("%");
+  float cellVoltage = cachedVoltage;
+  float cellPercent = cachedPercent;
   
   // For the ESP32-S2 Feather specifically:
   // 1. If voltage is below 2.5V, almost certainly no battery
@@ -70,7 +88,8 @@ bool BatteryManager::isUSBPowered() {
   // we can infer power source from the battery voltage behavior:
   // - If voltage remains constant at ~4.2V, likely USB powered & charged
   // - If voltage is slowly decreasing, likely on battery power
-  float currentVoltage = lc.cellVoltage();
+  if (!sample()) return true;
+  float currentVoltage = cachedVoltage;
   unsigned long currentTime = millis();
   
   // Only update our decision if enough time has passed
@@ -94,17 +113,17 @@ bool BatteryManager::isCharging() {
   if (!monitorAvailable || !isConnected()) return false;
   
   // If USB powered and voltage is below 4.2V, it's likely charging
-  return isUSBPowered() && (lc.cellVoltage() < 4.2);
+  return isUSBPowered() && (cachedVoltage < 4.2);
 }
 
 float BatteryManager::getVoltage() {
   if (!monitorAvailable || !isConnected()) return 0.0;
-  return lc.cellVoltage();
+  return cachedVoltage;
 }
 
 float BatteryManager::getPercentage() {
   if (!monitorAvailable || !isConnected()) return 0.0;
-  return lc.cellPercent();
+  return cachedPercent;
 }
 
 bool BatteryManager::isMonitorAvailable() const {
@@ -0,0 +1,146 @@
+// cbor.cpp
+#include "cbor.h"
+#include <string.h>
+#include <math.h>
+
+namespace cbor
+{
+    enum MajorType : uint8_t {
+        UNSIGNED = 0,
+        NEGATIVE = 1,
+        TEXT = 3,
+        ARRAY = 4,
+        MAP = 5,
+        SIMPLE = 7
+    };
+
+    enum SimpleValue : uint8_t {
+        FALSE_VALUE = 20,
+        TRUE_VALUE = 21,
+        NULL_VALUE = 22
+    };
+
+    // Counts every byte but only stores those that fit, so measure() is the same walk
+    class Writer {
+    public:
+        Writer(uint8_t *buffer, size_t capacity) : buffer(buffer), capacity(capacity), length(0) {}
+
+        void byte(uint8_t value) {
+            if (length < capacity) {
+                buffer[length] = value;
+            }
+            length++;
+        }
+
+        void bytes(const void *data, size_t count) {
+            if (length + count <= capacity) {
+                memcpy(buffer + length, data, count);
+            }
+            length += count;
+        }
+
+        // Big-endian, as CBOR requires
+        void bigEndian(uint64_t value, int count) {
+            for (int shift = (count - 1) * 8; shift >= 0; shift -= 8) {
+                byte(static_cast<uint8_t>(value >> shift));
+            }
+        }
+
+        // Initial byte plus the shortest argument encoding
+        void head(MajorType type, uint64_t argument) {
+            uint8_t major = static_cast<uint8_t>(type << 5);
+            if (argument < 24) {
+                byte(major | static_cast<uint8_t>(argument));
+            } else if (argument <= 0xFF) {
+                byte(major | 24);
+                bigEndian(argument, 1);
+            } else if (argument <= 0xFFFF) {
+                byte(major | 25);
+                bigEndian(argument, 2);
+            } else if (argument <= 0xFFFFFFFFULL) {
+                byte(major | 26);
+                bigEndian(argument, 4);
+            } else {
+                byte(major | 27);
+                bigEndian(argument, 8);
+            }
+        }
+
+        // Single precision when it round-trips exactly, which covers most sensor readings
+        void number(double value) {
+            float single = static_cast<float>(value);
+            if (static_cast<double>(single) == value || isnan(value)) {
+                uint32_t bits;
+                memcpy(&bits, &single, sizeof(bits));
+                byte(SIMPLE << 5 | 26);
+                bigEndian(bits, 4);
+            } else {
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                byte(SIMPLE << 5 | 27);
+                bigEndian(bits, 8);
+            }
+        }
+
+        void text(const char *value) {
+            size_t count = strlen(value);
+            head(TEXT, count);
+            bytes(value, count);
+        }
+
+        void value(JsonVariantConst source) {
+            if (source.is<bool>()) {
+                head(SIMPLE, source.as<bool>() ? TRUE_VALUE : FALSE_VALUE);
+            } else if (source.is<JsonUInt>()) {
+                head(UNSIGNED, source.as<JsonUInt>());
+            } else if (source.is<JsonInteger>()) {
+                // Negative integers encode -1 - n, which is ~n in two's complement
+                head(NEGATIVE, ~static_cast<uint64_t>(source.as<JsonInteger>()));
+            } else if (source.is<double>()) {
+                number(source.as<double>());
+            } else if (source.is<const char *>()) {
+                text(source.as<const char *>());
+            } else if (source.is<JsonArrayConst>()) {
+                JsonArrayConst array = source.as<JsonArrayConst>();
+                head(ARRAY, array.size());
+                for (JsonVariantConst element : array) {
+                    value(element);
+                }
+            } else if (source.is<JsonObjectConst>()) {
+                JsonObjectConst object = source.as<JsonObjectConst>();
+                head(MAP, object.size());
+                for (JsonPairConst pair : object) {
+                    text(pair.key().c_str());
+                    value(pair.value());
+                }
+            } else {
+                head(SIMPLE, NULL_VALUE);
+            }
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        bool fits() const {
+            return length <= capacity;
+        }
+
+    private:
+        uint8_t *buffer;
+        size_t capacity;
+        size_t length;
+    };
+
+    size_t measure(JsonVariantConst source) {
+        Writer writer(nullptr, 0);
+        writer.value(source);
+        return writer.size();
+    }
+
+    size_t serialize(JsonVariantConst source, uint8_t *buffer, size_t capacity) {
+        Writer writer(buffer, capacity);
+        writer.value(source);
+        return writer.fits() ? writer.size() : 0;
+    }
+}
@@ -0,0 +1,148 @@
+#include <Arduino.h>
+#include "dac_calibration.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+// NVS location of the measured curve
+static const char *CALIBRATION_NAMESPACE = "dac_cal";
+static const char *CALIBRATION_KEY = "points";
+
+DacCalibration::DacCalibration() : measured(false)
+{
+    loadDefaults();
+    buildTables();
+}
+
+void DacCalibration::begin() {
+    Preferences prefs;
+    prefs.begin(CALIBRATION_NAMESPACE, true);
+
+    uint16_t stored[DAC_CALIBRATION_POINTS];
+    size_t length = prefs.getBytes(CALIBRATION_KEY, stored, sizeof(stored));
+    prefs.end();
+
+    if (length == sizeof(stored)) {
+        memcpy(pointsMv, stored, sizeof(pointsMv));
+        measured = true;
+        LOG_INFO("DAC Cal", "Loaded measured calibration from NVS");
+    } else {
+        loadDefaults();
+        LOG_INFO("DAC Cal", "No calibration stored, using nominal curve");
+    }
+
+    buildTables();
+}
+
+uint8_t DacCalibration::codeForPoint(size_t index) {
+    return index == DAC_CALIBRATION_POINTS - 1 ? 255 : index * 16;
+}
+
+void DacCalibration::loadDefaults() {
+    for (size_t i = 0; i < DAC_CALIBRATION_POINTS; i++) {
+        pointsMv[i] = (uint32_t)codeForPoint(i) * DAC_CALIBRATION_MAX_MV / 255;
+    }
+    measured = false;
+}
+
+// Expand the measured points into the forward and inverse lookup tables
+void DacCalibration::buildTables() {
+    // Forward: piecewise-linear between calibration points
+    for (size_t i = 0; i + 1 < DAC_CALIBRATION_POINTS; i++) {
+        uint8_t codeLow = codeForPoint(i);
+        uint8_t codeHigh = codeForPoint(i + 1);
+        int32_t mvLow = pointsMv[i];
+        int32_t mvHigh = pointsMv[i + 1];
+
+        for (int code = codeLow; code <= codeHigh; code++) {
+            forwardMv[code] = mvLow + (mvHigh - mvLow) * (code - codeLow) / (codeHigh - codeLow);
+        }
+    }
+
+    // Inverse: for each voltage bucket, the code whose output is closest.
+    // Walks both tables once, relying on the curve being non-decreasing.
+    int code = 0;
+    for (size_t bucket = 0; bucket < sizeof(inverseCode); bucket++) {
+        uint16_t target = bucket * DAC_CALIBRATION_STEP_MV;
+        while (code < 255 && forwardMv[code + 1] <= target) {
+            code++;
+        }
+        if (code < 255 && (forwardMv[code + 1] - target) < (target - forwardMv[code])) {
+            inverseCode[bucket] = code + 1;
+        } else {
+            inverseCode[bucket] = code;
+        }
+    }
+}
+
+bool DacCalibration::save(const uint16_t *newPointsMv) {
+    // Reject curves that go backwards; the inverse table needs a monotonic response
+    for (size_t i = 0; i < DAC_CALIBRATION_POINTS; i++) {
+        if (newPointsMv[i] > DAC_CALIBRATION_MAX_MV || (i > 0 && newPointsMv[i] < newPointsMv[i - 1])) {
+            return false;
+        }
+    }
+
+    Preferences prefs;
+    prefs.begin(CALIBRATION_NAMESPACE, false);
+    size_t written = prefs.putBytes(CALIBRATION_KEY, newPointsMv, sizeof(pointsMv));
+    prefs.end();
+
+    if (written != sizeof(pointsMv)) {
+        return false;
+    }
+
+    memcpy(pointsMv, newPointsMv, sizeof(pointsMv));
+    measured = true;
+    buildTables();
+    LOG_INFO("DAC Cal", "Calibration saved");
+    return true;
+}
+
+void DacCalibration::reset() {
+    Preferences prefs;
+    prefs.begin(CALIBRATION_NAMESPACE, false);
+    prefs.remove(CALIBRATION_KEY);
+    prefs.end();
+
+    loadDefaults();
+    buildTables();
+    LOG_INFO("DAC Cal", "Calibration reset to nominal");
+}
+
+uint8_t DacCalibration::codeForMillivolts(uint16_t millivolts) const {
+    size_t bucket = (millivolts + DAC_CALIBRATION_STEP_MV / 2) / DAC_CALIBRATION_STEP_MV;
+    if (bucket >= sizeof(inverseCode)) {
+        bucket = sizeof(inverseCode) - 1;
+    }
+    return inverseCode[bucket];
+}
+
+uint16_t DacCalibration::millivoltsForCode(uint8_t code) const {
+    return forwardMv[code];
+}
+
+uint16_t DacCalibration::getMinMillivolts() const {
+    return forwardMv[0];
+}
+
+uint16_t DacCalibration::getMaxMillivolts() const {
+    return forwardMv[255];
+}
+
+bool DacCalibration::isMeasured() const {
+    return measured;
+}
+
+void DacCalibration::populateCalibration(JsonObject root) const {
+    root["measured"] = measured;
+    root["minMv"] = getMinMillivolts();
+    root["maxMv"] = getMaxMillivolts();
+
+    JsonArray codes = root["codes"].to<JsonArray>();
+    JsonArray points = root["pointsMv"].to<JsonArray>();
+    for (size_t i = 0; i < DAC_CALIBRATION_POINTS; i++) {
+        codes.add(codeForPoint(i));
+        points.add(pointsMv[i]);
+    }
+}
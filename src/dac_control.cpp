@@ -1,25 +1,881 @@
 #include <Arduino.h>
 #include "dac_control.h"
+#include "logger.h"
 #include <driver/dac.h>
+#include <hal/dac_ll.h>
+#include <hal/cpu_hal.h>
+#include <ArduinoJson.h>
 
+DACControl *DACControl::instance = nullptr;
 
-DACControl::DACControl() : value(0) {
+DACControl::DACControl() :
+    value(0),
+    lastSetpointTime(0),
+    appliedSetpoints(0),
+    sampleTimer(nullptr),
+    timerMux(portMUX_INITIALIZER_UNLOCKED),
+    pairedOutput(false),
+    pairing(ChannelPairing::None),
+    pairPhaseDegrees(0.0),
+    sampleIndex(0),
+    sampleStride(1),
+    outputMode(DacOutputMode::Static),
+    rampPosition(0),
+    rampStep(0),
+    rampTicksLeft(0),
+    rampCompleted(false),
+    rampTarget(0),
+    rampDurationMs(0),
+    streamSampleRate(0),
+    streamLoop(false),
+    streamUploadDone(false),
+    streamFinished(false),
+    streamPlaying(false),
+    streamOverflow(false),
+    streamReceiving(false),
+    streamIndex(0),
+    streamLength(0),
+    streamStarved(false),
+    streamUnderruns(0),
+    streamSamplesPlayed(0),
+    streamSamplesReceived(0),
+    triggerArmed(false),
+    triggerRearm(false),
+    triggerEdge(RISING),
+    triggerTarget(TriggerTarget::Waveform),
+    triggerMode(DacOutputMode::Static),
+    triggerAlarmTicks(0),
+    lastAlarmTicks(0),
+    sequenceTrigger(nullptr),
+    sequenceTriggerContext(nullptr),
+    triggerCount(0),
+    lastLatencyCycles(0),
+    minLatencyCycles(0),
+    maxLatencyCycles(0),
+    waveform(Waveform::Sine),
+    frequency(0.0),
+    actualFrequency(0.0),
+    sampleRate(0),
+    amplitude(0),
+    offset(0)
+{
+    memset(sampleBuffer, 0, sizeof(sampleBuffer));
+    memset(pairedBuffer, 0, sizeof(pairedBuffer));
+    dds::reset(oscillator, 0);
 }
 
 void DACControl::begin() {
     // For ESP32-S2, enable the DAC channel (A0/GPIO18 corresponds to DAC_CHANNEL_1)
     dac_output_enable(DAC_CHANNEL_1);
     dac_output_voltage(DAC_CHANNEL_1, value); // Initialize DAC to 0
+
+    // Load the measured voltage curve once; set-voltage requests only do table lookups
+    calibration.begin();
+
+    // The sample clock is created once and only armed while a waveform plays
+    instance = this;
+    sampleTimer = timerBegin(DAC_TIMER_NUM, DAC_TIMER_DIVIDER, true);
+    timerAttachInterrupt(sampleTimer, &DACControl::onSampleTimer, false); // S2 timers only support level interrupts
 }
 
 void DACControl::setValue(int newValue) {
+    // A static level replaces any running waveform
+    stopWaveform();
+
     // Constrain value to valid range (0-255)
     value = constrain(newValue, 0, 255);
-    
+
     // Update the DAC output
     dac_output_voltage(DAC_CHANNEL_1, value);
 }
 
 int DACControl::getValue() const {
     return value;
-}
\ No newline at end of file
+}
+
+bool DACControl::setVoltage(float volts) {
+    int millivolts = lround(volts * 1000.0);
+    if (millivolts < calibration.getMinMillivolts() || millivolts > calibration.getMaxMillivolts()) {
+        return false;
+    }
+
+    setValue(calibration.codeForMillivolts(millivolts));
+    return true;
+}
+
+float DACControl::getVoltage() const {
+    return calibration.millivoltsForCode(value) / 1000.0;
+}
+
+DacCalibration &DACControl::getCalibration() {
+    return calibration;
+}
+
+// Refused while a timer-driven output owns the DAC, so a writer that was not
+// stopped cannot fight it; this does not touch the sample timer
+bool IRAM_ATTR DACControl::writeFromISR(uint8_t code) {
+    if (outputMode != DacOutputMode::Static) {
+        return false;
+    }
+    value = code;
+    dac_ll_update_output_value(DAC_CHANNEL_1, code);
+    return true;
+}
+
+// For the feedback loop, which runs on its own task: adjusts the static level
+// but leaves any timer-driven output alone, checked under the ISR's lock
+bool DACControl::trimValue(int newValue) {
+    uint8_t code = constrain(newValue, 0, 255);
+
+    portENTER_CRITICAL(&timerMux);
+    bool isStatic = outputMode == DacOutputMode::Static;
+    if (isStatic) {
+        value = code;
+        dac_ll_update_output_value(DAC_CHANNEL_1, code);
+    }
+    portEXIT_CRITICAL(&timerMux);
+    return isStatic;
+}
+
+void DACControl::requestValue(int newValue) {
+    setpointMailbox.post(constrain(newValue, 0, 255));
+}
+
+// A ramp or one-shot stream the ISR has finished leaves the timer ticking idle:
+// park it and, for a ramp, adopt the target as the static level. Every path that
+// starts or stops an output calls this first, so a completion is never applied
+// to whatever was started after it.
+void DACControl::settleFinishedOutput() {
+    portENTER_CRITICAL(&timerMux);
+    bool rampDone = rampCompleted;
+    bool streamDone = streamFinished;
+    rampCompleted = false;
+    streamFinished = false;
+    // Only park the timer if nothing has been started on it since
+    if ((rampDone || streamDone) && outputMode == DacOutputMode::Static) {
+        timerAlarmDisable(sampleTimer);
+    }
+    portEXIT_CRITICAL(&timerMux);
+
+    if (rampDone) {
+        value = rampTarget;
+        LOG_INFO("DAC", "Ramp complete at %d", value);
+    }
+    if (streamDone) {
+        streamPlaying = false;
+        LOG_INFO("DAC", "Stream finished: %u samples, %u underruns", streamSamplesPlayed, streamUnderruns);
+    }
+}
+
+// Apply the most recent requested setpoint, at most once per DAC_SETPOINT_INTERVAL.
+// Anything posted in between is overwritten in the mailbox and never touches the DAC.
+void DACControl::update() {
+    settleFinishedOutput();
+
+    unsigned long currentTime = millis();
+    if (currentTime - lastSetpointTime < DAC_SETPOINT_INTERVAL) {
+        return;
+    }
+
+    int32_t latest;
+    if (setpointMailbox.take(latest)) {
+        lastSetpointTime = currentTime;
+        setValue(latest);
+        appliedSetpoints++;
+    }
+}
+
+void DACControl::populateSetpointStats(JsonObject root) const {
+    root["value"] = value;
+    root["posted"] = setpointMailbox.getPostedCount();
+    root["coalesced"] = setpointMailbox.getCoalescedCount();
+    root["applied"] = appliedSetpoints;
+    root["intervalMs"] = DAC_SETPOINT_INTERVAL;
+}
+
+void IRAM_ATTR DACControl::onSampleTimer() {
+    if (instance != nullptr) {
+        instance->serviceSampleTimer();
+    }
+}
+
+// Runs once per sample: one RAM read and one register write, no flash access
+void IRAM_ATTR DACControl::serviceSampleTimer() {
+    portENTER_CRITICAL_ISR(&timerMux);
+    if (outputMode == DacOutputMode::Dds) {
+        uint32_t index = dds::tableIndex(dds::step(oscillator), WAVE_TABLE_BITS);
+        dac_ll_update_output_value(DAC_CHANNEL_1, sampleBuffer[index]);
+        if (pairedOutput) {
+            // Same index, same tick: the pair cannot drift apart
+            dac_ll_update_output_value(DAC_CHANNEL_2, pairedBuffer[index]);
+        }
+    } else if (outputMode == DacOutputMode::Table) {
+        uint32_t index = sampleIndex;
+        dac_ll_update_output_value(DAC_CHANNEL_1, sampleBuffer[index]);
+        if (pairedOutput) {
+            dac_ll_update_output_value(DAC_CHANNEL_2, pairedBuffer[index]);
+        }
+        sampleIndex = (index + sampleStride) & (WAVE_TABLE_SIZE - 1);
+    } else if (outputMode == DacOutputMode::Ramp) {
+        if (--rampTicksLeft == 0) {
+            rampPosition = (uint32_t)rampTarget << 16;
+            outputMode = DacOutputMode::Static;
+            rampCompleted = true;
+        } else {
+            rampPosition += rampStep;
+        }
+        dac_ll_update_output_value(DAC_CHANNEL_1, rampPosition >> 16);
+    } else if (outputMode == DacOutputMode::Stream) {
+        uint8_t sample;
+        if (streamLoop) {
+            uint32_t index = streamIndex;
+            dac_ll_update_output_value(DAC_CHANNEL_1, streamBuffer.at(index));
+            streamIndex = (index + 1 == streamLength) ? 0 : index + 1;
+            streamSamplesPlayed++;
+        } else if (streamBuffer.pop(sample)) {
+            dac_ll_update_output_value(DAC_CHANNEL_1, sample);
+            streamSamplesPlayed++;
+            streamStarved = false;
+        } else if (streamUploadDone) {
+            outputMode = DacOutputMode::Static;
+            streamFinished = true;
+        } else if (!streamStarved) {
+            // Upload has not kept up; hold the last sample and count the dry-out once
+            streamStarved = true;
+            streamUnderruns++;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&timerMux);
+}
+
+// Scale the unit waveform into DAC codes once, so the ISR only copies samples
+void DACControl::fillSampleBuffer() {
+    const wavetable::Table &table = wavetable::forShape(waveform);
+    for (size_t i = 0; i < WAVE_TABLE_SIZE; i++) {
+        int sample = offset + (table.samples[i] * amplitude) / 127;
+        sampleBuffer[i] = constrain(sample, 0, 255);
+    }
+
+    if (pairing == ChannelPairing::None) {
+        return;
+    }
+
+    // Channel 2 is precomputed relative to channel 1 so the ISR uses one index for both
+    float degrees = pairing == ChannelPairing::Quadrature ? 90.0 : pairPhaseDegrees;
+    uint32_t shift = pairing == ChannelPairing::Differential
+                         ? 0
+                         : (uint32_t)lroundf(degrees / 360.0 * WAVE_TABLE_SIZE) & (WAVE_TABLE_SIZE - 1);
+    for (size_t i = 0; i < WAVE_TABLE_SIZE; i++) {
+        if (pairing == ChannelPairing::Differential) {
+            pairedBuffer[i] = constrain(2 * offset - sampleBuffer[i], 0, 255);
+        } else {
+            // Lagging by 'shift' samples means reading the table that much earlier
+            pairedBuffer[i] = sampleBuffer[(i - shift) & (WAVE_TABLE_SIZE - 1)];
+        }
+    }
+}
+
+// Stop the timer and load a new scaled waveform into the sample buffer
+bool DACControl::prepareWaveform(Waveform shape, uint8_t newAmplitude, uint8_t newOffset) {
+    if (sampleTimer == nullptr) {
+        return false;
+    }
+
+    settleFinishedOutput();
+    streamReceiving = false;
+    // A slider value posted just before must not stop the new output when loop() applies it
+    setpointMailbox.discard();
+    timerAlarmDisable(sampleTimer);
+
+    waveform = shape;
+    amplitude = min<uint8_t>(newAmplitude, 128);
+    offset = newOffset;
+
+    portENTER_CRITICAL(&timerMux);
+    outputMode = DacOutputMode::Static;
+    fillSampleBuffer();
+    pairedOutput = pairing != ChannelPairing::None;
+    portEXIT_CRITICAL(&timerMux);
+
+    if (pairedOutput) {
+        dac_output_enable(DAC_CHANNEL_2);
+    } else {
+        dac_output_disable(DAC_CHANNEL_2);
+    }
+    return true;
+}
+
+void DACControl::armSampleTimer(uint64_t alarmTicks) {
+    lastAlarmTicks = alarmTicks;
+    timerWrite(sampleTimer, 0);
+    timerAlarmWrite(sampleTimer, alarmTicks, true);
+    timerAlarmEnable(sampleTimer);
+}
+
+bool DACControl::startWaveform(Waveform shape, float newFrequency, uint8_t newAmplitude, uint8_t newOffset) {
+    // At least two samples per period are needed to reproduce any shape
+    // Written so NaN fails too
+    if (!(newFrequency >= 0.1 && newFrequency <= DAC_MAX_SAMPLE_RATE / 2)) {
+        return false;
+    }
+
+    // Skip table entries (power-of-two stride) until the sample rate fits the ISR budget
+    uint32_t stride = 1;
+    while (stride < WAVE_TABLE_SIZE / 2 &&
+           newFrequency * (WAVE_TABLE_SIZE / stride) > DAC_MAX_SAMPLE_RATE) {
+        stride <<= 1;
+    }
+    uint32_t samplesPerPeriod = WAVE_TABLE_SIZE / stride;
+    uint64_t alarmTicks = llround(DAC_TIMER_HZ / (newFrequency * samplesPerPeriod));
+    if (alarmTicks < 1) {
+        alarmTicks = 1;
+    }
+
+    pairing = ChannelPairing::None;
+    if (!prepareWaveform(shape, newAmplitude, newOffset)) {
+        return false;
+    }
+
+    frequency = newFrequency;
+    sampleRate = DAC_TIMER_HZ / alarmTicks;
+    actualFrequency = (float)DAC_TIMER_HZ / (alarmTicks * samplesPerPeriod);
+
+    portENTER_CRITICAL(&timerMux);
+    sampleIndex = 0;
+    sampleStride = stride;
+    outputMode = DacOutputMode::Table;
+    portEXIT_CRITICAL(&timerMux);
+
+    armSampleTimer(alarmTicks);
+
+    LOG_INFO("DAC", "Waveform %s started: %.2f Hz (%u samples/s, stride %u)",
+             waveformName(shape), actualFrequency, sampleRate, stride);
+    return true;
+}
+
+void DACControl::stopWaveform() {
+    settleFinishedOutput();
+    streamReceiving = false; // Any other output ends an upload in progress
+
+    // A waveform waiting for its trigger counts as running here
+    if (triggerArmed && triggerTarget == TriggerTarget::Waveform) {
+        disarmTrigger();
+    }
+
+    if (outputMode == DacOutputMode::Static) {
+        return;
+    }
+
+    timerAlarmDisable(sampleTimer);
+    portENTER_CRITICAL(&timerMux);
+    // An interrupted ramp holds wherever it got to instead of jumping back
+    // (rampPosition is the target if it finished since the settle above)
+    if (outputMode == DacOutputMode::Ramp || rampCompleted) {
+        value = rampPosition >> 16;
+    }
+    outputMode = DacOutputMode::Static;
+    rampCompleted = false;
+    streamFinished = false;
+    streamPlaying = false;
+    portEXIT_CRITICAL(&timerMux);
+
+    // Return to the last static level; channel 2 only exists while the generator runs
+    if (pairedOutput) {
+        pairedOutput = false;
+        dac_output_disable(DAC_CHANNEL_2);
+    }
+    dac_output_voltage(DAC_CHANNEL_1, value);
+    LOG_INFO("DAC", "Waveform stopped");
+}
+
+bool DACControl::isWaveformRunning() const {
+    return outputMode == DacOutputMode::Table || outputMode == DacOutputMode::Dds;
+}
+
+DacOutputMode DACControl::getOutputMode() const {
+    return outputMode;
+}
+
+bool DACControl::startDDS(Waveform shape, float newFrequency, uint8_t newAmplitude, uint8_t newOffset) {
+    pairing = ChannelPairing::None;
+    return startOscillator(shape, newFrequency, newAmplitude, newOffset);
+}
+
+bool DACControl::startGenerator(const GeneratorSettings &settings) {
+    if (!isfinite(settings.phaseDegrees)) {
+        return false;
+    }
+    pairing = settings.pairing;
+    pairPhaseDegrees = settings.phaseDegrees;
+    return startOscillator(settings.shape, settings.frequency, settings.amplitude, settings.offset);
+}
+
+ChannelPairing DACControl::getPairing() const {
+    return pairedOutput ? pairing : ChannelPairing::None;
+}
+
+// Below dds::minFrequency the phase never advances; above Nyquist the output aliases.
+// Both comparisons must pass, so NaN is rejected as well.
+static bool isDdsFrequency(float frequency) {
+    return frequency >= dds::minFrequency(DAC_DDS_SAMPLE_RATE) && frequency <= DAC_DDS_SAMPLE_RATE / 2;
+}
+
+bool DACControl::startOscillator(Waveform shape, float newFrequency, uint8_t newAmplitude, uint8_t newOffset) {
+    if (!isDdsFrequency(newFrequency)) {
+        return false;
+    }
+
+    if (!prepareWaveform(shape, newAmplitude, newOffset)) {
+        return false;
+    }
+
+    frequency = newFrequency;
+    sampleRate = DAC_DDS_SAMPLE_RATE;
+
+    portENTER_CRITICAL(&timerMux);
+    dds::reset(oscillator, dds::incrementForFrequency(newFrequency, DAC_DDS_SAMPLE_RATE));
+    outputMode = DacOutputMode::Dds;
+    portEXIT_CRITICAL(&timerMux);
+
+    actualFrequency = getCurrentFrequency();
+    armSampleTimer(DAC_TIMER_HZ / DAC_DDS_SAMPLE_RATE);
+
+    LOG_INFO("DAC", "DDS %s started: %.4f Hz, channel 2 %s",
+             waveformName(shape), actualFrequency, pairingName(getPairing()));
+    return true;
+}
+
+// Changes only the phase increment, so the output continues from the current phase
+bool DACControl::setFrequency(float newFrequency) {
+    if (outputMode != DacOutputMode::Dds || !isDdsFrequency(newFrequency)) {
+        return false;
+    }
+
+    uint64_t increment = dds::incrementForFrequency(newFrequency, DAC_DDS_SAMPLE_RATE);
+    portENTER_CRITICAL(&timerMux);
+    dds::setIncrement(oscillator, increment);
+    portEXIT_CRITICAL(&timerMux);
+
+    frequency = newFrequency;
+    actualFrequency = getCurrentFrequency();
+    return true;
+}
+
+bool DACControl::startSweep(float startFrequency, float endFrequency, uint32_t durationMs, dds::SweepMode mode) {
+    if (!isDdsFrequency(startFrequency) || !isDdsFrequency(endFrequency) ||
+        durationMs == 0 || mode == dds::SweepMode::None) {
+        return false;
+    }
+
+    // Sweeps use the current shape and level; start the oscillator if needed
+    if (outputMode != DacOutputMode::Dds && !startDDS(waveform, startFrequency, amplitude, offset)) {
+        return false;
+    }
+
+    uint64_t startIncrement = dds::incrementForFrequency(startFrequency, DAC_DDS_SAMPLE_RATE);
+    uint64_t endIncrement = dds::incrementForFrequency(endFrequency, DAC_DDS_SAMPLE_RATE);
+    uint32_t samples = (uint64_t)durationMs * DAC_DDS_SAMPLE_RATE / 1000;
+    if (samples == 0) {
+        samples = 1;
+    }
+
+    // Work out the log ratio outside the critical section, it needs pow()
+    uint32_t logRatio = dds::logSweepRatio(startIncrement, endIncrement, samples);
+
+    portENTER_CRITICAL(&timerMux);
+    if (mode == dds::SweepMode::Linear) {
+        dds::startLinearSweep(oscillator, startIncrement, endIncrement, samples);
+    } else {
+        dds::startLogSweep(oscillator, startIncrement, endIncrement, samples, logRatio);
+    }
+    portEXIT_CRITICAL(&timerMux);
+
+    frequency = endFrequency;
+    LOG_INFO("DAC", "%s sweep %.2f Hz -> %.2f Hz over %u ms",
+             mode == dds::SweepMode::Linear ? "Linear" : "Log", startFrequency, endFrequency, durationMs);
+    return true;
+}
+
+float DACControl::getCurrentFrequency() const {
+    if (outputMode != DacOutputMode::Dds) {
+        return actualFrequency;
+    }
+
+    portMUX_TYPE *mux = const_cast<portMUX_TYPE *>(&timerMux);
+    portENTER_CRITICAL(mux);
+    uint64_t increment = oscillator.increment;
+    portEXIT_CRITICAL(mux);
+    return dds::frequencyForIncrement(increment, DAC_DDS_SAMPLE_RATE);
+}
+
+bool DACControl::isSweeping() const {
+    return outputMode == DacOutputMode::Dds && oscillator.sweepMode != dds::SweepMode::None;
+}
+
+bool DACControl::startRamp(int target, uint32_t durationMs) {
+    if (sampleTimer == nullptr) {
+        return false;
+    }
+
+    // Ramps always start from the static level, so stop any waveform first
+    stopWaveform();
+    setpointMailbox.discard();
+
+    target = constrain(target, 0, 255);
+    uint32_t ticks = (uint64_t)durationMs * DAC_RAMP_TICK_HZ / 1000;
+    if (ticks == 0 || target == value) {
+        setValue(target);
+        return true;
+    }
+
+    rampTarget = target;
+    rampDurationMs = durationMs;
+
+    portENTER_CRITICAL(&timerMux);
+    rampPosition = (uint32_t)value << 16;
+    rampStep = ((int32_t)target - value) * 65536 / (int32_t)ticks;
+    rampTicksLeft = ticks;
+    outputMode = DacOutputMode::Ramp;
+    portEXIT_CRITICAL(&timerMux);
+
+    armSampleTimer(DAC_TIMER_HZ / DAC_RAMP_TICK_HZ);
+
+    LOG_INFO("DAC", "Ramp %d -> %d over %u ms", value, target, durationMs);
+    return true;
+}
+
+bool DACControl::startSlew(int target, float voltsPerSecond) {
+    if (!(voltsPerSecond > 0.0)) {
+        return false;
+    }
+
+    float deltaVolts = abs(constrain(target, 0, 255) - value) * DAC_FULL_SCALE_VOLTS / 255.0;
+    return startRamp(target, (uint32_t)(deltaVolts / voltsPerSecond * 1000.0 + 0.5));
+}
+
+bool DACControl::isRamping() const {
+    return outputMode == DacOutputMode::Ramp;
+}
+
+void DACControl::populateRamp(JsonObject root) const {
+    bool ramping = isRamping();
+    root["ramping"] = ramping;
+    root["value"] = ramping ? (int)(rampPosition >> 16) : value;
+    root["target"] = rampTarget;
+    root["durationMs"] = rampDurationMs;
+    // Widened: rampTicksLeft * 1000 passes 32 bits on ramps longer than about 71 minutes
+    root["remainingMs"] = ramping ? (uint32_t)((uint64_t)rampTicksLeft * 1000 / DAC_RAMP_TICK_HZ) : 0;
+}
+
+// Prepare for an upload. Playback starts once the buffer is half full (one-shot)
+// or once the whole waveform is in memory (loop).
+bool DACControl::beginStream(uint32_t sampleRate, bool loop) {
+    if (sampleTimer == nullptr || sampleRate == 0 || sampleRate > DAC_MAX_SAMPLE_RATE) {
+        return false;
+    }
+
+    stopWaveform();
+    setpointMailbox.discard();
+
+    streamBuffer.clear();
+    streamSampleRate = sampleRate;
+    streamLoop = loop;
+    streamUploadDone = false;
+    streamFinished = false;
+    streamPlaying = false;
+    streamOverflow = false;
+    streamIndex = 0;
+    streamLength = 0;
+    streamStarved = false;
+    streamUnderruns = 0;
+    streamSamplesPlayed = 0;
+    streamSamplesReceived = 0;
+    streamReceiving = true;
+    return true;
+}
+
+void DACControl::startStreamPlayback() {
+    settleFinishedOutput();
+
+    portENTER_CRITICAL(&timerMux);
+    outputMode = DacOutputMode::Stream;
+    portEXIT_CRITICAL(&timerMux);
+    streamPlaying = true;
+
+    armSampleTimer(DAC_TIMER_HZ / streamSampleRate);
+    LOG_INFO("DAC", "Stream playback started at %u samples/s (%s)",
+             streamSampleRate, streamLoop ? "loop" : "one-shot");
+}
+
+// Called from the upload handler with each chunk. In one-shot mode this waits
+// (briefly) for the ISR to drain space; in loop mode the whole waveform must fit.
+size_t DACControl::writeStream(const uint8_t *samples, size_t count) {
+    if (!streamReceiving) {
+        return 0;
+    }
+
+    size_t written = 0;
+    unsigned long waitStart = millis();
+
+    while (written < count) {
+        size_t chunk = streamBuffer.write(samples + written, count - written);
+        written += chunk;
+        streamSamplesReceived += chunk;
+
+        if (written == count) {
+            break;
+        }
+
+        if (streamLoop) {
+            streamOverflow = true;
+            break;
+        }
+
+        if (!streamPlaying) {
+            startStreamPlayback();
+        }
+
+        // Buffer full: let the sample clock make room, but never wait forever
+        if (millis() - waitStart > 1000) {
+            break;
+        }
+        delay(1);
+    }
+
+    if (!streamLoop && !streamPlaying && streamBuffer.size() >= streamBuffer.capacity() / 2) {
+        startStreamPlayback();
+    }
+    return written;
+}
+
+bool DACControl::endStream() {
+    if (!streamReceiving) {
+        return false;
+    }
+    if (streamOverflow || streamSamplesReceived == 0) {
+        abortStream();
+        return false;
+    }
+    streamReceiving = false;
+
+    if (streamLoop) {
+        streamIndex = 0;
+        streamLength = streamBuffer.size();
+        startStreamPlayback();
+    } else {
+        streamUploadDone = true;
+        if (!streamPlaying) {
+            startStreamPlayback();
+        }
+    }
+    return true;
+}
+
+void DACControl::abortStream() {
+    stopWaveform();
+    streamBuffer.clear();
+}
+
+bool DACControl::isStreamReceiving() const {
+    return streamReceiving;
+}
+
+void DACControl::populateStream(JsonObject root) const {
+    root["playing"] = streamPlaying && outputMode == DacOutputMode::Stream;
+    root["mode"] = streamLoop ? "loop" : "oneshot";
+    root["sampleRate"] = streamSampleRate;
+    root["received"] = streamSamplesReceived;
+    root["played"] = streamSamplesPlayed;
+    root["buffered"] = streamBuffer.size();
+    root["capacity"] = streamBuffer.capacity();
+    root["underruns"] = streamUnderruns;
+    root["overflow"] = streamOverflow;
+}
+
+void DACControl::populateWaveform(JsonObject root) const {
+    root["running"] = isWaveformRunning();
+    root["engine"] = outputMode == DacOutputMode::Dds ? "dds" : "table";
+    root["shape"] = waveformName(waveform);
+    root["frequency"] = frequency;
+    root["actualFrequency"] = outputMode == DacOutputMode::Dds ? getCurrentFrequency() : actualFrequency;
+    root["sweeping"] = isSweeping();
+    root["pairing"] = pairingName(getPairing());
+    root["phaseDegrees"] = pairPhaseDegrees;
+    root["sampleRate"] = sampleRate;
+    root["amplitude"] = amplitude;
+    root["offset"] = offset;
+}
+
+bool DACControl::parseWaveform(const String &name, Waveform &shape) {
+    if (name == "sine") {
+        shape = Waveform::Sine;
+    } else if (name == "triangle") {
+        shape = Waveform::Triangle;
+    } else if (name == "saw" || name == "sawtooth") {
+        shape = Waveform::Sawtooth;
+    } else if (name == "square") {
+        shape = Waveform::Square;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *DACControl::waveformName(Waveform shape) {
+    switch (shape) {
+    case Waveform::Sine:
+        return "sine";
+    case Waveform::Triangle:
+        return "triangle";
+    case Waveform::Sawtooth:
+        return "sawtooth";
+    case Waveform::Square:
+        return "square";
+    }
+    return "unknown";
+}
+
+bool DACControl::parsePairing(const String &name, ChannelPairing &result) {
+    if (name == "none" || name == "") {
+        result = ChannelPairing::None;
+    } else if (name == "quadrature" || name == "iq") {
+        result = ChannelPairing::Quadrature;
+    } else if (name == "differential") {
+        result = ChannelPairing::Differential;
+    } else if (name == "phase") {
+        result = ChannelPairing::Phase;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *DACControl::pairingName(ChannelPairing pairing) {
+    switch (pairing) {
+    case ChannelPairing::None:
+        return "none";
+    case ChannelPairing::Quadrature:
+        return "quadrature";
+    case ChannelPairing::Differential:
+        return "differential";
+    case ChannelPairing::Phase:
+        return "phase";
+    }
+    return "unknown";
+}
+
+// Arm TRIGGER_PIN. For waveforms the currently running table/DDS output is
+// stopped and preloaded, so the edge only has to flip the mode and re-arm the
+// sample clock. With rearm, every later edge restarts from phase zero.
+bool DACControl::armTrigger(TriggerTarget target, int edge, bool rearm) {
+    if (sampleTimer == nullptr) {
+        return false;
+    }
+
+    disarmTrigger();
+
+    if (target == TriggerTarget::Waveform) {
+        if (!isWaveformRunning()) {
+            return false;
+        }
+
+        timerAlarmDisable(sampleTimer);
+        portENTER_CRITICAL(&timerMux);
+        triggerMode = outputMode;
+        triggerAlarmTicks = lastAlarmTicks;
+        outputMode = DacOutputMode::Static;
+        portEXIT_CRITICAL(&timerMux);
+        dac_output_voltage(DAC_CHANNEL_1, value);
+    } else {
+        if (sequenceTrigger == nullptr) {
+            return false;
+        }
+        stopWaveform();
+    }
+
+    triggerTarget = target;
+    triggerEdge = edge;
+    triggerRearm = rearm;
+    triggerArmed = true;
+
+    pinMode(TRIGGER_PIN, INPUT_PULLDOWN);
+    attachInterruptArg(TRIGGER_PIN, &DACControl::onTriggerEdge, this, edge);
+
+    LOG_INFO("DAC", "Trigger armed on GPIO%d for %s", TRIGGER_PIN,
+             target == TriggerTarget::Waveform ? "waveform" : "sequence");
+    return true;
+}
+
+void DACControl::disarmTrigger() {
+    detachInterrupt(TRIGGER_PIN);
+    triggerArmed = false;
+}
+
+void DACControl::setSequenceTrigger(TriggerHandler handler, void *context) {
+    sequenceTrigger = handler;
+    sequenceTriggerContext = context;
+}
+
+void IRAM_ATTR DACControl::onTriggerEdge(void *arg) {
+    static_cast<DACControl *>(arg)->handleTrigger();
+}
+
+// Latency is counted in CPU cycles from ISR entry to the first sample (or the
+// first sequence step) being written.
+void IRAM_ATTR DACControl::handleTrigger() {
+    uint32_t entry = cpu_hal_get_cycle_count();
+
+    if (!triggerArmed) {
+        return;
+    }
+    if (!triggerRearm) {
+        triggerArmed = false;
+    }
+
+    if (triggerTarget == TriggerTarget::Waveform) {
+        portENTER_CRITICAL_ISR(&timerMux);
+        sampleIndex = 0;
+        oscillator.phase = 0;
+        outputMode = triggerMode;
+        portEXIT_CRITICAL_ISR(&timerMux);
+
+        // Emit the first sample right here instead of waiting for the next timer tick
+        serviceSampleTimer();
+        lastLatencyCycles = cpu_hal_get_cycle_count() - entry;
+
+        timerWrite(sampleTimer, 0);
+        timerAlarmWrite(sampleTimer, triggerAlarmTicks, true);
+        timerAlarmEnable(sampleTimer);
+    } else {
+        sequenceTrigger(sequenceTriggerContext);
+        lastLatencyCycles = cpu_hal_get_cycle_count() - entry;
+    }
+
+    uint32_t cycles = lastLatencyCycles;
+    if (triggerCount == 0 || cycles < minLatencyCycles) {
+        minLatencyCycles = cycles;
+    }
+    if (cycles > maxLatencyCycles) {
+        maxLatencyCycles = cycles;
+    }
+    triggerCount++;
+}
+
+void DACControl::populateTrigger(JsonObject root) const {
+    root["pin"] = TRIGGER_PIN;
+    root["armed"] = (bool)triggerArmed;
+    root["rearm"] = triggerRearm;
+    root["target"] = triggerTarget == TriggerTarget::Waveform ? "waveform" : "sequence";
+    root["edge"] = triggerEdge == RISING ? "rising" : triggerEdge == FALLING ? "falling" : "both";
+    root["count"] = (uint32_t)triggerCount;
+
+    // Cycles -> nanoseconds at the current CPU clock
+    uint32_t mhz = getCpuFrequencyMhz();
+    JsonObject latency = root["latencyNs"].to<JsonObject>();
+    if (triggerCount > 0) {
+        latency["last"] = (uint32_t)lastLatencyCycles * 1000 / mhz;
+        latency["min"] = (uint32_t)minLatencyCycles * 1000 / mhz;
+        latency["max"] = (uint32_t)maxLatencyCycles * 1000 / mhz;
+    }
+    root["latencyCyclesMax"] = (uint32_t)maxLatencyCycles;
+}
@@ -0,0 +1,205 @@
+#include <Arduino.h>
+#include "dac_feedback.h"
+#include "logger.h"
+#include <ArduinoJson.h>
+
+// Bounds on the integral term so a disconnected feedback wire cannot wind it up forever
+static const int32_t INTEGRAL_LIMIT = 64 * 65536;
+
+DacFeedbackLoop::DacFeedbackLoop(DACControl *dacControl) :
+    dacControl(dacControl),
+    taskHandle(nullptr),
+    paramMux(portMUX_INITIALIZER_UNLOCKED),
+    enabled(false),
+    targetMv(0),
+    rateHz(FEEDBACK_DEFAULT_RATE_HZ),
+    kp(FEEDBACK_DEFAULT_KP),
+    ki(FEEDBACK_DEFAULT_KI),
+    resetPending(false),
+    integral(0),
+    lastCode(-1),
+    measuredMv(0),
+    errorMv(0),
+    settled(false),
+    settlingTimeMs(0),
+    steadyStateErrorMv(0),
+    steadyStateAccumulator(0),
+    settleCount(0),
+    samplesSinceChange(0),
+    samplesTaken(0)
+{
+}
+
+void DacFeedbackLoop::begin() {
+    pinMode(FEEDBACK_ADC_PIN, INPUT);
+    analogSetPinAttenuation(FEEDBACK_ADC_PIN, ADC_11db); // Full 0-3.3 V range
+
+    // Above the Arduino loop so web traffic cannot stretch the control period
+    xTaskCreate(taskEntry, "dac_feedback", 3072, this, 2, &taskHandle);
+    LOG_INFO("DAC Loop", "Initialized");
+}
+
+void DacFeedbackLoop::taskEntry(void *param) {
+    static_cast<DacFeedbackLoop *>(param)->run();
+}
+
+void DacFeedbackLoop::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;) {
+        if (!enabled) {
+            // Sleep until enable() wakes us
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            lastWake = xTaskGetTickCount();
+            continue;
+        }
+
+        step();
+
+        vTaskDelayUntil(&lastWake, configTICK_RATE_HZ / rateHz);
+    }
+}
+
+// One controller update: measure, PI, write the corrected code
+void DacFeedbackLoop::step() {
+    portENTER_CRITICAL(&paramMux);
+    int32_t target = targetMv;
+    int32_t gainP = kp;
+    int32_t gainI = ki;
+    uint32_t rate = rateHz;
+    bool reset = resetPending;
+    resetPending = false;
+    portEXIT_CRITICAL(&paramMux);
+
+    // A new setpoint restarts the controller here, on the task that owns its state
+    if (reset) {
+        integral = 0;
+        lastCode = -1;
+        settled = false;
+        settleCount = 0;
+        settlingTimeMs = 0;
+        steadyStateErrorMv = 0;
+        samplesSinceChange = 0;
+    }
+
+    // Average a few conversions to take the edge off ADC noise
+    uint32_t sum = 0;
+    for (int i = 0; i < 4; i++) {
+        sum += analogReadMilliVolts(FEEDBACK_ADC_PIN);
+    }
+    int32_t measured = sum / 4;
+    int32_t error = target - measured;
+
+    // 64-bit products: a gain near FEEDBACK_MAX_GAIN times a full-scale error overflows 32 bits
+    int64_t accumulated = integral + (int64_t)gainI * error;
+    integral = constrain(accumulated, (int64_t)-INTEGRAL_LIMIT, (int64_t)INTEGRAL_LIMIT);
+
+    // Feed-forward from the calibration table, PI trims the remainder
+    int32_t correction = ((int64_t)gainP * error + integral) >> 16;
+    int code = constrain(dacControl->getCalibration().codeForMillivolts(target > 0 ? target : 0) + correction, 0, 255);
+    if (code != lastCode) {
+        if (!dacControl->trimValue(code)) {
+            // Another output owns the DAC now; trimming it would only fight it
+            LOG_WARN("DAC Loop", "Output taken over, disabling");
+            enabled = false;
+            return;
+        }
+        lastCode = code;
+    }
+
+    measuredMv = measured;
+    errorMv = error;
+    samplesTaken++;
+    samplesSinceChange++;
+
+    // Settling: first time the error stays inside tolerance for FEEDBACK_SETTLE_SAMPLES in a row
+    if (abs(error) <= FEEDBACK_TOLERANCE_MV) {
+        settleCount++;
+    } else {
+        settleCount = 0;
+    }
+
+    if (!settled && settleCount >= FEEDBACK_SETTLE_SAMPLES) {
+        settled = true;
+        // Time of the first in-tolerance sample, counted in periods so it cannot go negative
+        settlingTimeMs = (uint64_t)(samplesSinceChange - FEEDBACK_SETTLE_SAMPLES) * 1000 / rate;
+        steadyStateAccumulator = error * 256;
+    } else if (settled) {
+        // Exponential moving average (alpha = 1/16) of the error once settled
+        steadyStateAccumulator += (error * 256 - steadyStateAccumulator) / 16;
+    }
+    steadyStateErrorMv = steadyStateAccumulator / 256;
+}
+
+bool DacFeedbackLoop::enable(float targetVolts) {
+    DacCalibration &calibration = dacControl->getCalibration();
+    int32_t millivolts = lround(targetVolts * 1000.0);
+    if (millivolts < calibration.getMinMillivolts() || millivolts > calibration.getMaxMillivolts()) {
+        return false;
+    }
+
+    // The loop needs a static output to trim
+    dacControl->stopWaveform();
+
+    portENTER_CRITICAL(&paramMux);
+    targetMv = millivolts;
+    resetPending = true;
+    portEXIT_CRITICAL(&paramMux);
+
+    bool wasEnabled = enabled;
+    enabled = true;
+    if (!wasEnabled && taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
+    }
+
+    LOG_INFO("DAC Loop", "Tracking %d mV at %u Hz", millivolts, rateHz);
+    return true;
+}
+
+void DacFeedbackLoop::disable() {
+    if (enabled) {
+        enabled = false;
+        LOG_INFO("DAC Loop", "Disabled");
+    }
+}
+
+bool DacFeedbackLoop::isEnabled() const {
+    return enabled;
+}
+
+bool DacFeedbackLoop::setRate(uint32_t hz) {
+    if (hz == 0 || hz > FEEDBACK_MAX_RATE_HZ || configTICK_RATE_HZ % hz != 0) {
+        return false;
+    }
+    portENTER_CRITICAL(&paramMux);
+    rateHz = hz;
+    portEXIT_CRITICAL(&paramMux);
+    return true;
+}
+
+bool DacFeedbackLoop::setGains(int32_t kpQ16, int32_t kiQ16) {
+    if (kpQ16 < 0 || kpQ16 > FEEDBACK_MAX_GAIN || kiQ16 < 0 || kiQ16 > FEEDBACK_MAX_GAIN) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&paramMux);
+    kp = kpQ16;
+    ki = kiQ16;
+    portEXIT_CRITICAL(&paramMux);
+    return true;
+}
+
+void DacFeedbackLoop::populateStatus(JsonObject root) const {
+    root["enabled"] = (bool)enabled;
+    root["targetMv"] = targetMv;
+    root["measuredMv"] = (int32_t)measuredMv;
+    root["errorMv"] = (int32_t)errorMv;
+    root["code"] = dacControl->getValue();
+    root["rateHz"] = rateHz;
+    root["kp"] = kp;
+    root["ki"] = ki;
+    root["settled"] = (bool)settled;
+    root["settlingTimeMs"] = (uint32_t)settlingTimeMs;
+    root["steadyStateErrorMv"] = (int32_t)steadyStateErrorMv;
+    root["samples"] = samplesTaken;
+}
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "ethernet_controller.h"
+#include "logger.h"
 #include "config.h"
 #include <SPIFFS.h>
 
@@ -34,7 +35,7 @@ EthernetController::~EthernetController() {
 }
 
 bool EthernetController::begin(int cs_pin, int rst_pin) {
-    Serial.println("[Ethernet] Initializing Ethernet controller...");
+    LOG_INFO("Ethernet", "Initializing Ethernet controller...");
     
     this->cs_pin = cs_pin;
     this->rst_pin = rst_pin;
@@ -60,13 +61,12 @@ bool EthernetController::begin(int cs_pin, int rst_pin) {
     
     // Check for hardware
     if (Ethernet.hardwareStatus() == EthernetNoHardware) {
-        Serial.println("[Ethernet] Shield was not found. Please check connections.");
+        LOG_ERROR("Ethernet", "Shield was not found. Please check connections.");
         initialized = false;
         return false;
     }
     
-    Serial.print("[Ethernet] Connected with IP: ");
-    Serial.println(Ethernet.localIP());
+    LOG_INFO("Ethernet", "Connected with IP: %s", Ethernet.localIP().toString().c_str());
     initialized = true;
     return true;
 }
@@ -83,29 +83,23 @@ bool EthernetController::isConnected() const {
     return (Ethernet.linkStatus() == LinkON);
 }
 
-String EthernetController::getStatusJSON() {
-    JsonDocument doc;
-    
-    doc["connected"] = isConnected();
-    doc["ip"] = Ethernet.localIP().toString();
-    doc["gateway"] = Ethernet.gatewayIP().toString();
-    doc["subnet"] = Ethernet.subnetMask().toString();
-    doc["dns"] = Ethernet.dnsServerIP().toString();
-    
-    String jsonString;
-    serializeJson(doc, jsonString);
-    return jsonString;
+void EthernetController::populateStatus(JsonObject root) {
+    root["connected"] = isConnected();
+    root["ip"] = Ethernet.localIP().toString();
+    root["gateway"] = Ethernet.gatewayIP().toString();
+    root["subnet"] = Ethernet.subnetMask().toString();
+    root["dns"] = Ethernet.dnsServerIP().toString();
 }
 
 bool EthernetController::loadConfig() {
     if (!SPIFFS.exists(CONFIG_FILE)) {
-        Serial.println("[Ethernet] Config file not found. Using defaults.");
+        LOG_INFO("Ethernet", "Config file not found. Using defaults.");
         return saveConfig(); // Create default config file
     }
     
     File configFile = SPIFFS.open(CONFIG_FILE, "r");
     if (!configFile) {
-        Serial.println("[Ethernet] Failed to open config file. Using defaults.");
+        LOG_WARN("Ethernet", "Failed to open config file. Using defaults.");
         return false;
     }
     
@@ -114,8 +108,7 @@ bool EthernetController::loadConfig() {
     configFile.close();
     
     if (error) {
-        Serial.print("[Ethernet] Failed to parse config file: ");
-        Serial.println(error.c_str());
+        LOG_WARN("Ethernet", "Failed to parse config file: %s", error.c_str());
         return false;
     }
     
@@ -146,7 +139,7 @@ bool EthernetController::loadConfig() {
         dns.fromString(doc["dns"].as<String>());
     }
     
-    Serial.println("[Ethernet] Configuration loaded from SPIFFS");
+    LOG_INFO("Ethernet", "Configuration loaded from SPIFFS");
     return true;
 }
 
@@ -168,24 +161,24 @@ bool EthernetController::saveConfig() {
     // Open file for writing
     File configFile = SPIFFS.open(CONFIG_FILE, "w");
     if (!configFile) {
-        Serial.println("[Ethernet] Failed to open config file for writing");
+        LOG_ERROR("Ethernet", "Failed to open config file for writing");
         return false;
     }
     
     // Write to file and close
     if (serializeJson(doc, configFile) == 0) {
-        Serial.println("[Ethernet] Failed to write to config file");
+        LOG_ERROR("Ethernet", "Failed to write to config file");
         configFile.close();
         return false;
     }
     
     configFile.close();
-    Serial.println("[Ethernet] Configuration saved to SPIFFS");
+    LOG_INFO("Ethernet", "Configuration saved to SPIFFS");
     return true;
 }
 
 bool EthernetController::updateConfig(IPAddress newIp, IPAddress newGateway, IPAddress newSubnet, IPAddress newDns) {
-    Serial.println("[Ethernet] Updating configuration...");
+    LOG_INFO("Ethernet", "Updating configuration...");
     
     ip = newIp;
     gateway = newGateway;
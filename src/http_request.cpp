@@ -0,0 +1,362 @@
+// http_request.cpp
+#include "http_request.h"
+#include "cbor.h"
+#include <memory>
+
+HttpRequest::HttpRequest(httpd_req_t *req) : req(req),
+                                             bodyRead(false),
+                                             responded(false),
+                                             headerCount(0)
+{
+    status[0] = '\0';
+
+    size_t queryLength = httpd_req_get_url_query_len(req);
+    if (queryLength > 0)
+    {
+        std::unique_ptr<char[]> buffer(new char[queryLength + 1]);
+        if (httpd_req_get_url_query_str(req, buffer.get(), queryLength + 1) == ESP_OK)
+        {
+            query = buffer.get();
+        }
+    }
+}
+
+httpd_req_t *HttpRequest::handle() const
+{
+    return req;
+}
+
+String HttpRequest::path() const
+{
+    String uri = req->uri;
+    int queryStart = uri.indexOf('?');
+    return queryStart < 0 ? uri : uri.substring(0, queryStart);
+}
+
+bool HttpRequest::hasArg(const char *name)
+{
+    if (strcmp(name, "plain") == 0)
+    {
+        return req->content_len > 0 && readBody();
+    }
+    if (query.length() == 0)
+    {
+        return false;
+    }
+
+    // A truncated result still means the key is present
+    char probe[2];
+    esp_err_t result = httpd_query_key_value(query.c_str(), name, probe, sizeof(probe));
+    return result == ESP_OK || result == ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+String HttpRequest::arg(const char *name)
+{
+    if (strcmp(name, "plain") == 0)
+    {
+        return readBody() ? body : String();
+    }
+    if (query.length() == 0)
+    {
+        return String();
+    }
+
+    // A value can never be longer than the query string it came from
+    std::unique_ptr<char[]> value(new char[query.length() + 1]);
+    if (httpd_query_key_value(query.c_str(), name, value.get(), query.length() + 1) != ESP_OK)
+    {
+        return String();
+    }
+    return urlDecode(value.get());
+}
+
+String HttpRequest::header(const char *name) const
+{
+    size_t length = httpd_req_get_hdr_value_len(req, name);
+    if (length == 0)
+    {
+        return String();
+    }
+
+    std::unique_ptr<char[]> value(new char[length + 1]);
+    if (httpd_req_get_hdr_value_str(req, name, value.get(), length + 1) != ESP_OK)
+    {
+        return String();
+    }
+    return String(value.get());
+}
+
+// Collects the whole body once, for handlers that parse it as a document
+bool HttpRequest::readBody()
+{
+    if (bodyRead)
+    {
+        return body.length() > 0;
+    }
+    bodyRead = true;
+
+    if (req->content_len == 0 || req->content_len > HTTP_MAX_BODY_SIZE)
+    {
+        return false;
+    }
+
+    std::unique_ptr<char[]> buffer(new char[req->content_len + 1]);
+    size_t received = 0;
+    while (received < req->content_len)
+    {
+        int count = receive(reinterpret_cast<uint8_t *>(buffer.get()) + received, req->content_len - received);
+        if (count <= 0)
+        {
+            return false;
+        }
+        received += count;
+    }
+    buffer[received] = '\0';
+    body = buffer.get();
+    return true;
+}
+
+size_t HttpRequest::contentLength() const
+{
+    return req->content_len;
+}
+
+// Returns the number of bytes read, 0 at the end of the body, or < 0 if the client went away
+int HttpRequest::receive(uint8_t *buffer, size_t length)
+{
+    // A slow sender gets a few recv timeouts' grace before the upload is given up
+    for (int attempt = 0; attempt < HTTP_RECV_RETRIES; attempt++)
+    {
+        int count = httpd_req_recv(req, reinterpret_cast<char *>(buffer), length);
+        if (count != HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            return count;
+        }
+    }
+    return HTTPD_SOCK_ERR_TIMEOUT;
+}
+
+void HttpRequest::sendHeader(const String &name, const String &value)
+{
+    if (headerCount < MAX_HEADERS)
+    {
+        headerNames[headerCount] = name;
+        headerValues[headerCount] = value;
+        headerCount++;
+    }
+}
+
+void HttpRequest::prepareResponse(int code, const char *contentType)
+{
+    snprintf(status, sizeof(status), "%d %s", code, reasonPhrase(code));
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, contentType);
+    for (size_t i = 0; i < headerCount; i++)
+    {
+        httpd_resp_set_hdr(req, headerNames[i].c_str(), headerValues[i].c_str());
+    }
+    responded = true;
+}
+
+void HttpRequest::send(int code, const char *contentType, const String &content)
+{
+    prepareResponse(code, contentType);
+    httpd_resp_send(req, content.c_str(), content.length());
+}
+
+void HttpRequest::send(int code, const char *contentType, const uint8_t *content, size_t length)
+{
+    prepareResponse(code, contentType);
+    httpd_resp_send(req, reinterpret_cast<const char *>(content), length);
+}
+
+void HttpRequest::send(int code, const JsonDocument &doc)
+{
+    BodyEncoding encoding = acceptedEncoding();
+    sendHeader("Vary", "Accept");
+
+    if (encoding == BodyEncoding::Json)
+    {
+        String content;
+        serializeJson(doc, content);
+        prepareResponse(code, contentType(encoding));
+        httpd_resp_send(req, content.c_str(), content.length());
+        return;
+    }
+
+    // Encoded straight from the document, without a JSON string in between
+    size_t length = encoding == BodyEncoding::Cbor ? cbor::measure(doc.as<JsonVariantConst>()) : measureMsgPack(doc);
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[length]);
+    if (encoding == BodyEncoding::Cbor)
+    {
+        cbor::serialize(doc.as<JsonVariantConst>(), buffer.get(), length);
+    }
+    else
+    {
+        serializeMsgPack(doc, buffer.get(), length);
+    }
+    send(code, contentType(encoding), buffer.get(), length);
+}
+
+// The first supported media type in Accept wins; q-values are not weighed
+BodyEncoding HttpRequest::acceptedEncoding() const
+{
+    String accept = header("Accept");
+    int start = 0;
+    while (start < (int)accept.length())
+    {
+        int end = accept.indexOf(',', start);
+        if (end < 0)
+        {
+            end = accept.length();
+        }
+
+        String type = accept.substring(start, end);
+        int parameters = type.indexOf(';');
+        if (parameters >= 0)
+        {
+            type = type.substring(0, parameters);
+        }
+        type.trim();
+
+        if (type == "application/cbor")
+        {
+            return BodyEncoding::Cbor;
+        }
+        if (type == "application/msgpack" || type == "application/x-msgpack" || type == "application/vnd.msgpack")
+        {
+            return BodyEncoding::MessagePack;
+        }
+        if (type == "application/json")
+        {
+            return BodyEncoding::Json;
+        }
+        start = end + 1;
+    }
+    return BodyEncoding::Json;
+}
+
+// Sends the file in chunks so large assets never sit in RAM as a whole
+bool HttpRequest::streamFile(File &file, const char *contentType)
+{
+    prepareResponse(200, contentType);
+
+    char buffer[HTTP_CHUNK_SIZE];
+    while (file.available())
+    {
+        size_t count = file.read(reinterpret_cast<uint8_t *>(buffer), sizeof(buffer));
+        if (count == 0)
+        {
+            break;
+        }
+        if (httpd_resp_send_chunk(req, buffer, count) != ESP_OK)
+        {
+            return false;
+        }
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0) == ESP_OK;
+}
+
+bool HttpRequest::beginEventStream()
+{
+    String head = "HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/event-stream\r\n"
+                  "Cache-Control: no-cache\r\n";
+    bool connectionQueued = false;
+    for (size_t i = 0; i < headerCount; i++)
+    {
+        head += headerNames[i] + ": " + headerValues[i] + "\r\n";
+        connectionQueued = connectionQueued || headerNames[i].equalsIgnoreCase("Connection");
+    }
+    // A queued Connection header (close, once the keep-alive limit is reached)
+    // replaces the default rather than contradicting it
+    if (!connectionQueued)
+    {
+        head += "Connection: keep-alive\r\n";
+    }
+    head += "\r\n";
+
+    responded = true;
+    return httpd_send(req, head.c_str(), head.length()) == (int)head.length();
+}
+
+int HttpRequest::socket() const
+{
+    return httpd_req_to_sockfd(req);
+}
+
+bool HttpRequest::hasResponded() const
+{
+    return responded;
+}
+
+String HttpRequest::urlDecode(const char *encoded)
+{
+    String decoded;
+    decoded.reserve(strlen(encoded));
+
+    for (const char *p = encoded; *p; p++)
+    {
+        if (*p == '+')
+        {
+            decoded += ' ';
+        }
+        else if (*p == '%' && isxdigit(p[1]) && isxdigit(p[2]))
+        {
+            char hex[3] = {p[1], p[2], '\0'};
+            decoded += static_cast<char>(strtol(hex, nullptr, 16));
+            p += 2;
+        }
+        else
+        {
+            decoded += *p;
+        }
+    }
+    return decoded;
+}
+
+const char *HttpRequest::contentType(BodyEncoding encoding)
+{
+    switch (encoding)
+    {
+    case BodyEncoding::MessagePack:
+        return "application/msgpack";
+    case BodyEncoding::Cbor:
+        return "application/cbor";
+    default:
+        return "application/json";
+    }
+}
+
+const char *HttpRequest::reasonPhrase(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 202:
+        return "Accepted";
+    case 204:
+        return "No Content";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 406:
+        return "Not Acceptable";
+    case 409:
+        return "Conflict";
+    case 413:
+        return "Payload Too Large";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "";
+    }
+}
@@ -0,0 +1,204 @@
+// i2c_bus.cpp
+#include "i2c_bus.h"
+#include <ArduinoJson.h>
+
+I2CBus::I2CBus() :
+    mux(portMUX_INITIALIZER_UNLOCKED),
+    owner(nullptr),
+    waiters{},
+    waiterCount(0),
+    nextTicket(0),
+    currentClock(I2C_BUS_CLOCK),
+    transactions(0),
+    contended(0),
+    timeouts(0),
+    errors(0),
+    maxWaitUs(0)
+{
+}
+
+void I2CBus::begin() {
+    Wire.begin();
+    Wire.setClock(I2C_BUS_CLOCK);
+    currentClock = I2C_BUS_CLOCK;
+}
+
+// Takes the bus or queues for it. release() hands the bus straight to the
+// chosen waiter and then notifies it, so ownership is checked again after
+// every wake-up rather than trusting the notification itself.
+bool I2CBus::acquire(I2CPriority priority, uint32_t clockHz) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint32_t start = micros();
+
+    portENTER_CRITICAL(&mux);
+    bool waiting = false;
+    if (owner == nullptr) {
+        owner = self;
+    } else if (waiterCount < I2C_MAX_WAITERS) {
+        waiters[waiterCount++] = {self, priority, nextTicket++};
+        waiting = true;
+    } else {
+        timeouts++;
+        portEXIT_CRITICAL(&mux);
+        return false;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (waiting) {
+        TickType_t started = xTaskGetTickCount();
+        TickType_t timeout = pdMS_TO_TICKS(I2C_LOCK_TIMEOUT_MS);
+        for (;;) {
+            TickType_t elapsed = xTaskGetTickCount() - started;
+
+            portENTER_CRITICAL(&mux);
+            bool granted = owner == self;
+            bool expired = !granted && elapsed >= timeout;
+            if (expired) {
+                removeWaiter(self);
+                timeouts++;
+            }
+            portEXIT_CRITICAL(&mux);
+
+            if (granted) {
+                break;
+            }
+            if (expired) {
+                return false;
+            }
+            ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+        }
+
+        contended++;
+        maxWaitUs = max(maxWaitUs, (uint32_t)(micros() - start));
+    }
+
+    uint32_t clock = clockHz != 0 ? clockHz : I2C_BUS_CLOCK;
+    if (clock != currentClock) {
+        Wire.setClock(clock);
+        currentClock = clock;
+    }
+    return true;
+}
+
+void I2CBus::release() {
+    portENTER_CRITICAL(&mux);
+    TaskHandle_t next = nullptr;
+    if (waiterCount > 0) {
+        size_t best = 0;
+        for (size_t i = 1; i < waiterCount; i++) {
+            bool higher = waiters[i].priority > waiters[best].priority;
+            bool earlier = waiters[i].priority == waiters[best].priority &&
+                           (int32_t)(waiters[i].ticket - waiters[best].ticket) < 0;
+            if (higher || earlier) {
+                best = i;
+            }
+        }
+        next = waiters[best].task;
+        waiters[best] = waiters[--waiterCount];
+    }
+    owner = next;
+    portEXIT_CRITICAL(&mux);
+
+    if (next != nullptr) {
+        xTaskNotifyGive(next);
+    }
+}
+
+// Call with mux held
+void I2CBus::removeWaiter(TaskHandle_t task) {
+    for (size_t i = 0; i < waiterCount; i++) {
+        if (waiters[i].task == task) {
+            waiters[i] = waiters[--waiterCount];
+            return;
+        }
+    }
+}
+
+// Write tx, then read rx after a repeated start; call while holding the bus
+bool I2CBus::transfer(uint8_t address, const uint8_t *tx, size_t txLength, uint8_t *rx, size_t rxLength) {
+    transactions++;
+
+    Wire.beginTransmission(address);
+    if (txLength > 0) {
+        Wire.write(tx, txLength);
+    }
+    if (Wire.endTransmission(rxLength == 0) != 0) {
+        errors++;
+        return false;
+    }
+    if (rxLength == 0) {
+        return true;
+    }
+
+    if (Wire.requestFrom((int)address, (int)rxLength) != (int)rxLength) {
+        errors++;
+        return false;
+    }
+    for (size_t i = 0; i < rxLength; i++) {
+        rx[i] = Wire.read();
+    }
+    return true;
+}
+
+bool I2CBus::probe(uint8_t address, I2CPriority priority, uint32_t clockHz) {
+    if (!acquire(priority, clockHz)) {
+        return false;
+    }
+
+    // A missing device NACKs; that is an answer, not a bus error
+    transactions++;
+    Wire.beginTransmission(address);
+    bool present = Wire.endTransmission() == 0;
+
+    release();
+    return present;
+}
+
+bool I2CBus::writeRead(uint8_t address, const uint8_t *tx, size_t txLength, uint8_t *rx, size_t rxLength,
+                       I2CPriority priority) {
+    if (!acquire(priority, 0)) {
+        return false;
+    }
+    bool ok = transfer(address, tx, txLength, rx, rxLength);
+    release();
+    return ok;
+}
+
+bool I2CBus::readRegisters(uint8_t address, const I2CRegisterRead *reads, size_t count, I2CPriority priority) {
+    if (!acquire(priority, 0)) {
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = transfer(address, &reads[i].reg, 1, reads[i].data, reads[i].length);
+    }
+
+    release();
+    return ok;
+}
+
+void I2CBus::populateStats(JsonObject root) const {
+    root["clockHz"] = currentClock;
+    root["transactions"] = transactions;
+    root["contended"] = contended;
+    root["maxWaitUs"] = maxWaitUs;
+    root["timeouts"] = timeouts;
+    root["errors"] = errors;
+}
+
+I2CBus::Lock::Lock(I2CBus &bus, I2CPriority priority, uint32_t clockHz) :
+    bus(bus),
+    held(bus.acquire(priority, clockHz))
+{
+}
+
+I2CBus::Lock::~Lock() {
+    if (held) {
+        bus.release();
+    }
+}
+
+bool I2CBus::Lock::isHeld() const {
+    return held;
+}
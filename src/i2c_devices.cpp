@@ -0,0 +1,104 @@
+// i2c_devices.cpp
+#include "i2c_devices.h"
+
+namespace i2c_devices
+{
+    // Candidates for an address are tried in this order, so at a shared address
+    // the likelier guess comes first among parts without an ID register. INA219
+    // sits after the SHT31 and ADS1115 inside its range so that they can still be
+    // guessed; its configuration register is read, so it confirms ahead of them.
+    static constexpr Device DEVICES[] = {
+        {0x0B, 0x0B, "LC709203F", "fuel gauge", false, 0, 0, 0, false},
+        {0x10, 0x10, "VEML7700", "light", false, 0, 0, 0, false},
+        {0x18, 0x19, "LIS3DH", "accelerometer", true, 0x0F, 0xFF, 0x33, false},
+        {0x18, 0x1F, "MCP9808", "temperature", true, 0x07, 0xFF, 0x04, false},  // Device ID, high byte
+        {0x1C, 0x1E, "LIS3MDL", "magnetometer", true, 0x0F, 0xFF, 0x3D, false},
+        {0x1D, 0x1D, "ADXL345", "accelerometer", true, 0x00, 0xFF, 0xE5, false},
+        {0x23, 0x23, "BH1750", "light", false, 0, 0, 0, true},                 // Every byte is an opcode
+        {0x29, 0x29, "VL53L0X", "distance", true, 0xC0, 0xFF, 0xEE, false},
+        {0x29, 0x29, "TSL2591", "light", true, 0xB2, 0xFF, 0x50, false},        // Command bit | ID register
+        {0x36, 0x36, "MAX17048", "fuel gauge", false, 0, 0, 0, false},
+        {0x38, 0x38, "AHT20", "humidity", false, 0, 0, 0, false},
+        {0x39, 0x39, "APDS9960", "light/gesture", true, 0x92, 0xFF, 0xAB, false},
+        {0x3C, 0x3D, "SSD1306", "display", false, 0, 0, 0, false},
+        {0x44, 0x45, "SHT31", "humidity", false, 0, 0, 0, false},
+        {0x48, 0x4B, "ADS1115", "ADC", false, 0, 0, 0, false},
+        {0x40, 0x4F, "INA219", "power monitor", true, 0x00, 0xFF, 0x39, false}, // Configuration reset value, high byte
+        {0x53, 0x53, "ADXL345", "accelerometer", true, 0x00, 0xFF, 0xE5, false},
+        {0x50, 0x57, "24LC256", "EEPROM", false, 0, 0, 0, false},
+        {0x5A, 0x5B, "CCS811", "air quality", true, 0x20, 0xFF, 0x81, false},
+        {0x60, 0x67, "MCP4725", "DAC", false, 0, 0, 0, false},
+        {0x68, 0x69, "MPU6050", "IMU", true, 0x75, 0x7E, 0x68, false},          // WHO_AM_I ignores AD0
+        {0x68, 0x68, "DS3231", "RTC", false, 0, 0, 0, false},
+        {0x76, 0x77, "BME280", "pressure/humidity", true, 0xD0, 0xFF, 0x60, false},
+        {0x76, 0x77, "BMP280", "pressure", true, 0xD0, 0xFF, 0x58, false},
+        {0x76, 0x77, "BME680", "gas/pressure", true, 0xD0, 0xFF, 0x61, false},
+        {0x76, 0x77, "BMP388", "pressure", true, 0x00, 0xFF, 0x50, false},
+        {0x70, 0x77, "TCA9548A", "I2C mux", false, 0, 0, 0, true},             // The byte is the channel mask
+    };
+
+    static constexpr size_t DEVICE_COUNT = sizeof(DEVICES) / sizeof(DEVICES[0]);
+
+    static constexpr bool devicesValid()
+    {
+        for (size_t i = 0; i < DEVICE_COUNT; i++) {
+            const Device &device = DEVICES[i];
+            if (device.firstAddress > device.lastAddress || device.lastAddress > 0x7F) {
+                return false;
+            }
+            if (device.hasId && (device.idValue & ~device.idMask) != 0) {
+                return false;
+            }
+            if (device.hasId && device.writeIsCommand) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(DEVICE_COUNT < UNKNOWN, "registry index must fit in a byte");
+    static_assert(devicesValid(), "DEVICES has an invalid address range, ID mask or probe flag");
+
+    // True when a candidate at the address would act on the register pointer
+    // an ID read writes first
+    static bool writeIsCommand(uint8_t address) {
+        for (size_t i = 0; i < DEVICE_COUNT; i++) {
+            const Device &device = DEVICES[i];
+            if (device.writeIsCommand && address >= device.firstAddress && address <= device.lastAddress) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Identity identify(I2CBus &bus, uint8_t address, bool probe) {
+        Identity guess = {UNKNOWN, false};
+        probe = probe && !writeIsCommand(address);
+
+        for (size_t i = 0; i < DEVICE_COUNT; i++) {
+            const Device &device = DEVICES[i];
+            if (address < device.firstAddress || address > device.lastAddress) {
+                continue;
+            }
+
+            // Unread candidates are only a guess, and the first one listed is the best
+            if (!device.hasId || !probe) {
+                if (guess.device == UNKNOWN) {
+                    guess.device = static_cast<uint8_t>(i);
+                }
+                continue;
+            }
+
+            uint8_t value = 0;
+            if (bus.writeRead(address, &device.idRegister, 1, &value, 1, I2CPriority::Background) &&
+                (value & device.idMask) == device.idValue) {
+                return {static_cast<uint8_t>(i), true};
+            }
+        }
+        return guess;
+    }
+
+    const Device *get(uint8_t index) {
+        return index < DEVICE_COUNT ? &DEVICES[index] : nullptr;
+    }
+}
@@ -1,121 +1,228 @@
 #include <Arduino.h>
 #include "i2c_scanner.h"
-
-I2CScanner::I2CScanner() : scanComplete(false)
+#include "logger.h"
+#include <ArduinoJson.h>
+
+static const uint8_t SCAN_TOTAL = I2C_SCAN_LAST_ADDRESS - I2C_SCAN_FIRST_ADDRESS + 1;
+
+I2CScanner::I2CScanner(I2CBus *bus) : bus(bus),
+                                      scanTask(nullptr),
+                                      stateMux(portMUX_INITIALIZER_UNLOCKED),
+                                      state(ScanState::Idle),
+                                      jobId(0),
+                                      clockHz(I2C_SCAN_DEFAULT_CLOCK),
+                                      probed(0),
+                                      deviceCount(0),
+                                      found{},
+                                      identifyParts(true),
+                                      identities{}
 {
 }
 
 void I2CScanner::begin()
 {
-    // I2C is already initialized in main.cpp
-    Serial.println("[I2C Scanner] Initialized");
+    // The bus is brought up by I2CBus::begin(); the task sleeps until a scan is started
+    xTaskCreate(&I2CScanner::scanLoop, "i2c_scan", I2C_SCAN_TASK_STACK_SIZE, this, I2C_SCAN_TASK_PRIORITY, &scanTask);
+    LOG_INFO("I2C Scanner", "Initialized");
+}
+
+bool I2CScanner::startScan(uint32_t busClock, bool identify)
+{
+    if (scanTask == nullptr)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL(&stateMux);
+    bool busy = state == ScanState::Running;
+    if (!busy)
+    {
+        state = ScanState::Running;
+        jobId++;
+        clockHz = constrain(busClock, I2C_SCAN_MIN_CLOCK, I2C_SCAN_MAX_CLOCK);
+        identifyParts = identify;
+        probed = 0;
+        deviceCount = 0;
+        memset(found, 0, sizeof(found));
+    }
+    portEXIT_CRITICAL(&stateMux);
+
+    if (!busy)
+    {
+        xTaskNotifyGive(scanTask);
+    }
+    return !busy;
 }
 
-// Modified i2c_scanner.cpp for better reliability
-void I2CScanner::scan()
+void I2CScanner::scanLoop(void *arg)
 {
-    Serial.println("[I2C Scanner] Starting scan...");
-
-    // Clear previous results
-    foundAddresses.clear();
-    scanComplete = false;
-
-    // Save current I2C settings
-    uint32_t originalClock = Wire.getClock();
-    
-    // Reset I2C
-    Wire.end();
-    delay(100);
-    Wire.begin();
-    
-    // Use 100kHz clock - same as most Arduino examples
-    Wire.setClock(100000);
-
-    byte error, address;
-    int deviceCount = 0;
-
-    // Use exact approach from standard Arduino scanner
-    for(address = 1; address < 127; address++)
+    I2CScanner *scanner = static_cast<I2CScanner *>(arg);
+    for (;;)
     {
-        Serial.println(address); // Keep this for debugging
-        
-        // Add a small delay to give time for serial output
-        delay(5);
-        
-        // The i2c_scanner uses the return value of
-        // the Write.endTransmission to see if
-        // a device did acknowledge to the address.
-        Wire.beginTransmission(address);
-        error = Wire.endTransmission();
-
-        if (error == 0)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // A bus handoff that raced a lock timeout can leave a stray notification
+        if (scanner->getState() == ScanState::Running)
         {
-            Serial.print("[I2C Scanner] Device found at address 0x");
-            if (address < 16)
-                Serial.print("0");
-            Serial.print(address, HEX);
-            Serial.println("  !");
-            
-            foundAddresses.push_back(address);
-            deviceCount++;
+            scanner->runScan();
         }
     }
-    
-    // Restore original I2C settings
-    Wire.end();
-    delay(50);
-    Wire.begin();
-    Wire.setClock(originalClock);
-    
-    Serial.print("[I2C Scanner] Scan complete. Found ");
-    Serial.print(deviceCount);
-    Serial.println(" devices.");
-
-    scanComplete = true;
 }
 
-const std::vector<uint8_t> &I2CScanner::getFoundAddresses() const
+// Runs on the scan task. Each probe takes the bus on its own, at the scan clock,
+// so higher priority users wait at most one probe.
+void I2CScanner::runScan()
 {
-    return foundAddresses;
+    portENTER_CRITICAL(&stateMux);
+    uint32_t job = jobId;
+    uint32_t scanClock = clockHz;
+    bool identify = identifyParts;
+    portEXIT_CRITICAL(&stateMux);
+
+    LOG_INFO("I2C Scanner", "Scan %u started at %u Hz", job, scanClock);
+
+    for (uint8_t address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++)
+    {
+        // An address that acknowledges an empty write is a device
+        bool present = bus->probe(address, I2CPriority::Background, scanClock);
+        i2c_devices::Identity identity = {i2c_devices::UNKNOWN, false};
+        if (present)
+        {
+            identity = i2c_devices::identify(*bus, address, identify);
+        }
+
+        portENTER_CRITICAL(&stateMux);
+        if (present)
+        {
+            found[address / 32] |= 1UL << (address % 32);
+            if (deviceCount < I2C_SCAN_MAX_IDENTIFIED)
+            {
+                identities[deviceCount] = identity;
+            }
+            deviceCount++;
+        }
+        probed++;
+        portEXIT_CRITICAL(&stateMux);
+
+        if (present)
+        {
+            const i2c_devices::Device *device = i2c_devices::get(identity.device);
+            LOG_INFO("I2C Scanner", "Device found at address 0x%02X: %s%s", address,
+                     device != nullptr ? device->part : "unknown", identity.confirmed ? "" : " (unconfirmed)");
+        }
+    }
+
+    portENTER_CRITICAL(&stateMux);
+    state = ScanState::Done;
+    uint8_t devices = deviceCount;
+    portEXIT_CRITICAL(&stateMux);
+
+    LOG_INFO("I2C Scanner", "Scan %u complete. Found %u devices.", job, devices);
 }
 
-bool I2CScanner::isScanComplete() const
+ScanState I2CScanner::getState() const
 {
-    return scanComplete;
+    return state;
 }
 
-void I2CScanner::clearScanResults()
+bool I2CScanner::isFound(uint8_t address) const
 {
-    foundAddresses.clear();
-    scanComplete = false;
-    Serial.println("[I2C Scanner] Results cleared");
+    return address < 128 && (found[address / 32] & (1UL << (address % 32))) != 0;
 }
 
-String I2CScanner::getJSONResults() const
+uint32_t I2CScanner::getCompletedJob() const
 {
-    String json = "{\"scanComplete\":" + String(scanComplete ? "true" : "false") + ",";
-    json += "\"devices\":[";
+    portENTER_CRITICAL(&stateMux);
+    uint32_t job = state == ScanState::Done ? jobId : 0;
+    portEXIT_CRITICAL(&stateMux);
+    return job;
+}
 
-    if (scanComplete)
+size_t I2CScanner::getDevices(ScannedDevice *devices, size_t capacity) const
+{
+    portENTER_CRITICAL(&stateMux);
+    size_t count = 0;
+    for (uint8_t address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS && count < capacity; address++)
     {
-        for (size_t i = 0; i < foundAddresses.size(); i++)
+        if (found[address / 32] & (1UL << (address % 32)))
         {
-            if (i > 0)
+            devices[count].address = address;
+            if (count < I2C_SCAN_MAX_IDENTIFIED)
             {
-                json += ",";
+                devices[count].identity = identities[count];
             }
-
-            uint8_t address = foundAddresses[i];
-            json += "{";
-            json += "\"address\":" + String(address) + ",";
-            json += "\"hexAddress\":\"0x";
-            if (address < 16) json += "0"; // Ensure two-digit hex format
-            json += String(address, HEX) + "\"";
-            json += "}";
+            else
+            {
+                devices[count].identity = {i2c_devices::UNKNOWN, false};
+            }
+            count++;
         }
     }
+    portEXIT_CRITICAL(&stateMux);
+    return count;
+}
 
-    json += "]}";
+void I2CScanner::clearScanResults()
+{
+    portENTER_CRITICAL(&stateMux);
+    if (state != ScanState::Running)
+    {
+        state = ScanState::Idle;
+        probed = 0;
+        deviceCount = 0;
+        memset(found, 0, sizeof(found));
+    }
+    portEXIT_CRITICAL(&stateMux);
+    LOG_INFO("I2C Scanner", "Results cleared");
+}
 
-    return json;
-}
\ No newline at end of file
+// Devices appear in the list as soon as they are found, so a poller can show them mid-scan
+void I2CScanner::populateStatus(JsonObject root) const
+{
+    portENTER_CRITICAL(&stateMux);
+    ScanState current = state;
+    uint32_t job = jobId;
+    uint32_t scanClock = clockHz;
+    bool identify = identifyParts;
+    uint8_t count = probed;
+    uint32_t bits[4];
+    memcpy(bits, found, sizeof(bits));
+    i2c_devices::Identity named[I2C_SCAN_MAX_IDENTIFIED];
+    memcpy(named, identities, sizeof(named));
+    portEXIT_CRITICAL(&stateMux);
+
+    root["job"] = job;
+    root["state"] = current == ScanState::Running ? "running" : current == ScanState::Done ? "done" : "idle";
+    root["clockHz"] = scanClock;
+    root["identify"] = identify;
+    root["probed"] = count;
+    root["total"] = SCAN_TOTAL;
+    root["scanComplete"] = current == ScanState::Done;
+
+    JsonArray devices = root["devices"].to<JsonArray>();
+    size_t index = 0;
+    for (uint8_t address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++)
+    {
+        if (bits[address / 32] & (1UL << (address % 32)))
+        {
+            JsonObject device = devices.add<JsonObject>();
+            char hex[5];
+            snprintf(hex, sizeof(hex), "0x%02x", address);
+            device["address"] = address;
+            device["hexAddress"] = hex;
+
+            const i2c_devices::Device *part = nullptr;
+            if (index < I2C_SCAN_MAX_IDENTIFIED)
+            {
+                part = i2c_devices::get(named[index].device);
+            }
+            if (part != nullptr)
+            {
+                device["part"] = part->part;
+                device["kind"] = part->kind;
+                device["confirmed"] = named[index].confirmed;
+            }
+            index++;
+        }
+    }
+}
@@ -0,0 +1,168 @@
+// live_state.cpp
+#include "live_state.h"
+#include <WiFi.h>
+
+LiveState::LiveState(DHTSensor *dhtSensor, DACControl *dacControl, BatteryManager *batteryManager) :
+    dhtSensor(dhtSensor),
+    dacControl(dacControl),
+    batteryManager(batteryManager),
+    current{},
+    version(0),
+    fieldVersions{},
+    lastBatteryRead(0)
+{
+}
+
+static const char *const FIELD_NAMES[STATE_FIELD_COUNT] = {"sensor", "clients", "led", "dac", "battery"};
+
+// A sensor that is not ready reports NaN, which must compare equal to itself here
+static bool sameReading(float a, float b) {
+    return a == b || (isnan(a) && isnan(b));
+}
+
+void LiveState::readBattery(StateSnapshot &next) {
+    if (!batteryManager->isMonitorAvailable()) {
+        next.batteryConnected = false;
+        next.usbPowered = true;
+        return;
+    }
+
+    next.batteryConnected = batteryManager->isConnected();
+    if (next.batteryConnected) {
+        // Rounded to what the UI shows, so ADC noise does not count as a change
+        next.batteryVoltage = roundf(batteryManager->getVoltage() * 100.0f) / 100.0f;
+        next.batteryPercent = roundf(batteryManager->getPercentage() * 10.0f) / 10.0f;
+        next.usbPowered = batteryManager->isUSBPowered();
+        next.charging = batteryManager->isCharging();
+    } else {
+        next.batteryVoltage = 0.0f;
+        next.batteryPercent = 0.0f;
+        next.usbPowered = true;
+        next.charging = false;
+    }
+}
+
+uint32_t LiveState::refresh() {
+    StateSnapshot next = current;
+
+    next.sensorReady = dhtSensor->isReady();
+    next.temperature = dhtSensor->getTemperature();
+    next.humidity = dhtSensor->getHumidity();
+    next.clients = WiFi.softAPgetStationNum();
+    next.led = digitalRead(LED_PIN);
+    next.dac = dacControl->getValue();
+
+    bool first = version == 0;
+    if (first || millis() - lastBatteryRead >= STATE_BATTERY_INTERVAL) {
+        lastBatteryRead = millis();
+        readBattery(next);
+    }
+
+    // Everything counts as changed the first time, so version 1 is a full snapshot
+    uint32_t changed = first ? STATE_ALL : 0;
+    if (next.sensorReady != current.sensorReady || !sameReading(next.temperature, current.temperature) ||
+        !sameReading(next.humidity, current.humidity)) {
+        changed |= STATE_SENSOR;
+    }
+    if (next.clients != current.clients) {
+        changed |= STATE_CLIENTS;
+    }
+    if (next.led != current.led) {
+        changed |= STATE_LED;
+    }
+    if (next.dac != current.dac) {
+        changed |= STATE_DAC;
+    }
+    if (next.batteryConnected != current.batteryConnected || next.batteryVoltage != current.batteryVoltage ||
+        next.batteryPercent != current.batteryPercent || next.usbPowered != current.usbPowered ||
+        next.charging != current.charging) {
+        changed |= STATE_BATTERY;
+    }
+
+    if (changed != 0) {
+        current = next;
+        version++;
+        for (size_t i = 0; i < STATE_FIELD_COUNT; i++) {
+            if (changed & (1UL << i)) {
+                fieldVersions[i] = version;
+            }
+        }
+    }
+    return changed;
+}
+
+uint32_t LiveState::changedSince(uint32_t since) const {
+    if (since > version) {
+        return STATE_ALL;
+    }
+
+    uint32_t changed = 0;
+    for (size_t i = 0; i < STATE_FIELD_COUNT; i++) {
+        if (fieldVersions[i] > since) {
+            changed |= 1UL << i;
+        }
+    }
+    return changed;
+}
+
+bool LiveState::parseFields(const String &list, uint32_t &fields) {
+    fields = 0;
+    int start = 0;
+    while (start <= (int)list.length()) {
+        int end = list.indexOf(',', start);
+        if (end < 0) {
+            end = list.length();
+        }
+
+        String name = list.substring(start, end);
+        name.trim();
+        if (name.length() > 0) {
+            size_t i = 0;
+            while (i < STATE_FIELD_COUNT && name != FIELD_NAMES[i]) {
+                i++;
+            }
+            if (i == STATE_FIELD_COUNT) {
+                return false;
+            }
+            fields |= 1UL << i;
+        }
+        start = end + 1;
+    }
+    return fields != 0;
+}
+
+uint32_t LiveState::getVersion() const {
+    return version;
+}
+
+const StateSnapshot &LiveState::getSnapshot() const {
+    return current;
+}
+
+void LiveState::toJSON(JsonObject root, uint32_t fields) const {
+    if (fields & STATE_SENSOR) {
+        JsonObject sensor = root["sensor"].to<JsonObject>();
+        sensor["ready"] = current.sensorReady;
+        sensor["temperature"] = current.temperature;
+        sensor["humidity"] = current.humidity;
+    }
+    if (fields & STATE_CLIENTS) {
+        root["clients"] = current.clients;
+    }
+    if (fields & STATE_LED) {
+        root["led"] = current.led;
+    }
+    if (fields & STATE_DAC) {
+        root["dac"] = current.dac;
+    }
+    if (fields & STATE_BATTERY) {
+        JsonObject battery = root["battery"].to<JsonObject>();
+        battery["connected"] = current.batteryConnected;
+        if (current.batteryConnected) {
+            battery["voltage"] = current.batteryVoltage;
+            battery["percentage"] = current.batteryPercent;
+            battery["charging"] = current.charging;
+        }
+        battery["usbPowered"] = current.usbPowered;
+    }
+}
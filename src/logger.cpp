@@ -0,0 +1,112 @@
+// logger.cpp
+#include "logger.h"
+#include <ArduinoJson.h>
+#include <stdarg.h>
+
+Logger logger;
+
+static const char *const LEVEL_NAMES[] = {"error", "warn", "info", "debug"};
+
+Logger::Logger() :
+    buffer(nullptr),
+    drainTask(nullptr),
+    level(LogLevel::Info),
+    written(0),
+    dropped(0)
+{
+}
+
+void Logger::begin() {
+    buffer = xRingbufferCreate(LOG_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (buffer == nullptr) {
+        Serial.println("[Log] Ring buffer allocation failed, logging synchronously");
+        return;
+    }
+    xTaskCreate(&Logger::drainLoop, "log", LOG_TASK_STACK_SIZE, this, LOG_TASK_PRIORITY, &drainTask);
+}
+
+void Logger::setLevel(LogLevel newLevel) {
+    level.store(newLevel, std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const {
+    return level.load(std::memory_order_relaxed);
+}
+
+void Logger::log(LogLevel messageLevel, const char *tag, const char *format, ...) {
+    char line[LOG_LINE_MAX];
+    const int capacity = sizeof(line) - 1; // Keeps room for the newline
+    int length = min(snprintf(line, capacity, "[%s] ", tag), capacity - 1);
+
+    va_list args;
+    va_start(args, format);
+    length += vsnprintf(line + length, capacity - length, format, args);
+    va_end(args);
+
+    // A line that was cut short ends in "..."
+    if (length >= capacity) {
+        length = capacity - 1;
+        memcpy(line + length - 3, "...", 3);
+    }
+    if (line[length - 1] != '\n') {
+        line[length++] = '\n';
+    }
+
+    // Before begin(), or without a buffer, there is no task to hand the line to
+    if (buffer == nullptr) {
+        Serial.write(reinterpret_cast<const uint8_t *>(line), length);
+        written++;
+        return;
+    }
+
+    if (xRingbufferSend(buffer, line, length, 0) == pdTRUE) {
+        written++;
+    } else {
+        dropped++;
+    }
+}
+
+// Serial writes block at 115200 baud, so they only ever happen here
+void Logger::drainLoop(void *arg) {
+    Logger *self = static_cast<Logger *>(arg);
+    uint32_t droppedReported = 0;
+
+    for (;;) {
+        size_t size = 0;
+        void *line = xRingbufferReceive(self->buffer, &size, pdMS_TO_TICKS(LOG_DROP_REPORT_INTERVAL));
+        if (line != nullptr) {
+            Serial.write(static_cast<const uint8_t *>(line), size);
+            vRingbufferReturnItem(self->buffer, line);
+        }
+
+        uint32_t droppedNow = self->dropped.load();
+        if (droppedNow != droppedReported) {
+            Serial.printf("[Log] %u lines dropped\n", droppedNow - droppedReported);
+            droppedReported = droppedNow;
+        }
+    }
+}
+
+void Logger::populateStats(JsonObject root) const {
+    root["level"] = levelName(getLevel());
+    root["written"] = written.load();
+    root["dropped"] = dropped.load();
+    root["bufferSize"] = LOG_BUFFER_SIZE;
+    if (buffer != nullptr) {
+        root["bufferFree"] = xRingbufferGetCurFreeSize(buffer);
+    }
+}
+
+bool Logger::parseLevel(const String &name, LogLevel &level) {
+    for (size_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); i++) {
+        if (name.equalsIgnoreCase(LEVEL_NAMES[i])) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *Logger::levelName(LogLevel level) {
+    return LEVEL_NAMES[static_cast<size_t>(level)];
+}
@@ -3,12 +3,18 @@
 #include <Wire.h>
 #include <SPIFFS.h>
 #include "config.h"
+#include "logger.h"
 #include "dht_sensor.h"
 #include "dac_control.h"
 #include "neopixel_manager.h"
+#include "i2c_bus.h"
 #include "i2c_scanner.h"
+#include "sensor_scheduler.h"
 #include "battery_manager.h"
 #include "system_info.h"
+#include "sequence_player.h"
+#include "dac_feedback.h"
+#include "live_state.h"
 #include "webserver_manager.h"
 #include <SPI.h>
 #include "ethernet_controller.h"
@@ -24,10 +30,17 @@
 DHTSensor dhtSensor;
 DACControl dacControl;
 NeoPixelManager neoPixel;
-I2CScanner i2cScanner;
-BatteryManager batteryManager;
+I2CBus i2cBus;
+I2CScanner i2cScanner(&i2cBus);
+SensorScheduler sensorScheduler(&i2cBus, &i2cScanner);
+BatteryManager batteryManager(&i2cBus);
 SystemInfo systemInfo(&batteryManager);
-WebServerManager webServer(80, &dhtSensor, &dacControl, &i2cScanner, &systemInfo, &batteryManager, &ethernetController);
+SequencePlayer sequencePlayer(&dacControl);
+DacFeedbackLoop feedbackLoop(&dacControl);
+LiveState liveState(&dhtSensor, &dacControl, &batteryManager);
+WebServerManager webServer(80, &dhtSensor, &dacControl, &i2cScanner, &i2cBus, &sensorScheduler,
+                           &systemInfo, &batteryManager, &sequencePlayer, &feedbackLoop, &liveState,
+                           &ethernetController);
 
 void setup()
 {
@@ -38,76 +51,82 @@ void setup()
   Serial.begin(115200);
   delay(3000);
 
+  // Serial output goes through the logger's drain task from here on
+  logger.begin();
+
   // Check reset reason
   esp_reset_reason_t reason = esp_reset_reason();
-  Serial.print("Reset reason: ");
   switch (reason)
   {
   case ESP_RST_POWERON:
-    Serial.println("Power-on reset");
+    LOG_INFO("Boot", "Reset reason: Power-on reset");
     break;
   case ESP_RST_SW:
-    Serial.println("Software reset");
+    LOG_INFO("Boot", "Reset reason: Software reset");
     break;
   case ESP_RST_PANIC:
-    Serial.println("Software panic reset");
+    LOG_WARN("Boot", "Reset reason: Software panic reset");
     break;
   case ESP_RST_INT_WDT:
-    Serial.println("Interrupt watchdog reset");
+    LOG_WARN("Boot", "Reset reason: Interrupt watchdog reset");
     break;
   case ESP_RST_TASK_WDT:
-    Serial.println("Task watchdog reset");
+    LOG_WARN("Boot", "Reset reason: Task watchdog reset");
     break;
   case ESP_RST_WDT:
-    Serial.println("Other watchdog reset");
+    LOG_WARN("Boot", "Reset reason: Other watchdog reset");
     break;
   default:
-    Serial.printf("Unknown reset reason: %d\n", reason);
+    LOG_WARN("Boot", "Unknown reset reason: %d", reason);
   }
 
   // Configure the watchdog
   esp_task_wdt_init(30, false); // 30 second timeout, no panic
 
-  Serial.println("ESP32-S2 Feather starting up...");
+  LOG_INFO("Boot", "ESP32-S2 Feather starting up...");
 
   // Set LED pin as output
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, LOW); // Start with LED off
 
-  // Initialize I2C
-  Wire.begin();
+  // Initialize I2C; everything else reaches Wire through the bus arbiter
+  i2cBus.begin();
 
   // Initialize components
   batteryManager.begin();
   dacControl.begin();
+  sequencePlayer.begin();
+  feedbackLoop.begin();
   neoPixel.begin();
   dhtSensor.begin();
   i2cScanner.begin();
 
+  // Scan once at boot so the sensor drivers attach to whatever is on the bus
+  sensorScheduler.begin();
+  i2cScanner.startScan();
+
   // Initialize SPIFFS
   if (!SPIFFS.begin(true))
   {
-    Serial.println("An Error has occurred while mounting SPIFFS");
+    LOG_ERROR("Boot", "An Error has occurred while mounting SPIFFS");
     return;
   }
 
   // List files in SPIFFS for debugging
-  Serial.println("Files found in SPIFFS:");
+  LOG_DEBUG("Boot", "Files found in SPIFFS:");
   File root = SPIFFS.open("/");
   File file = root.openNextFile();
 
   while (file)
   {
-    Serial.print("  ");
-    Serial.println(file.name());
+    LOG_DEBUG("Boot", "  %s", file.name());
     file = root.openNextFile();
   }
 
   // Configure access point
   WiFi.softAP(ap_ssid, ap_password);
   WiFi.softAPConfig(local_ip, gateway, subnet);
-  Serial.print("Access Point IP address: ");
-  Serial.println(WiFi.softAPIP());
+  LOG_INFO("Boot", "Access Point IP address: %s", WiFi.softAPIP().toString().c_str());
 
   delay(100);
 
@@ -129,12 +148,23 @@ void setup()
 
 void loop()
 {
-  // Handle client requests
-  webServer.handleClient();
+  // Requests are served by the HTTP server task. Apply the latest DAC setpoint
+  // it posted; if a handler is busy with the DAC right now, try again next pass
+  if (webServer.tryLockControl())
+  {
+    dacControl.update();
+    webServer.unlockControl();
+  }
 
   // Update sensor readings
   dhtSensor.update();
 
+  // Push whatever changed to WebSocket clients and telemetry to SSE subscribers,
+  // then drop keep-alive connections that have gone idle
+  webServer.publishState();
+  webServer.publishEvents();
+  webServer.sweepConnections();
+
   // Check client connections and update NeoPixel accordingly
   int clientCount = WiFi.softAPgetStationNum();
   neoPixel.setConnectionState(clientCount > 0);
@@ -149,7 +179,7 @@ void loop()
   if (millis() - lastHeapCheck > 5000)
   { // Every 5 seconds
     lastHeapCheck = millis();
-    Serial.printf("Free heap: %u bytes\n", ESP.getFreeHeap());
+    LOG_DEBUG("System", "Free heap: %u bytes", ESP.getFreeHeap());
   }
 
   // Small delay to prevent hogging the CPU
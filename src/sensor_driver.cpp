@@ -0,0 +1,207 @@
+// sensor_driver.cpp
+#include "sensor_driver.h"
+#include <new>
+
+SensorDriver::SensorDriver() :
+    bus(nullptr),
+    address(0)
+{
+}
+
+bool SensorDriver::begin(I2CBus *bus, uint8_t address) {
+    this->bus = bus;
+    this->address = address;
+    return configure();
+}
+
+bool SensorDriver::writeRegister(uint8_t reg, uint8_t value) {
+    const uint8_t data[] = {reg, value};
+    return bus->writeRead(address, data, sizeof(data), nullptr, 0, I2CPriority::Normal);
+}
+
+// MCP9808: ambient temperature, converting continuously from power-up
+class Mcp9808Driver : public SensorDriver {
+protected:
+    bool configure() override {
+        uint8_t id[2];
+        I2CRegisterRead read = {0x06, id, sizeof(id)}; // Manufacturer ID
+        return bus->readRegisters(address, &read, 1, I2CPriority::Normal) && id[0] == 0x00 && id[1] == 0x54;
+    }
+
+public:
+    size_t sample(SensorValue *values) override {
+        uint8_t raw[2];
+        I2CRegisterRead read = {0x05, raw, sizeof(raw)};
+        if (!bus->readRegisters(address, &read, 1, I2CPriority::Normal)) {
+            return 0;
+        }
+
+        // 13-bit two's complement, 1/16 degree per bit
+        int16_t counts = static_cast<int16_t>((((raw[0] & 0x1F) << 8) | raw[1]) << 3) >> 3;
+        values[0] = {"temperature", "C", counts / 16.0f};
+        return 1;
+    }
+};
+
+// BME280 and BMP280: temperature, pressure and (BME280 only) humidity, using
+// Bosch's integer compensation. Runs in normal mode, so a sample is one burst read.
+class Bme280Driver : public SensorDriver {
+private:
+    bool hasHumidity;
+    uint16_t t1;
+    int16_t t2, t3;
+    uint16_t p1;
+    int16_t p2, p3, p4, p5, p6, p7, p8, p9;
+    uint8_t h1, h3;
+    int16_t h2, h4, h5;
+    int8_t h6;
+
+    static uint16_t u16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+    static int16_t s16(const uint8_t *data) { return static_cast<int16_t>(u16(data)); }
+
+protected:
+    bool configure() override {
+        uint8_t chipId = 0;
+        I2CRegisterRead idRead = {0xD0, &chipId, 1};
+        if (!bus->readRegisters(address, &idRead, 1, I2CPriority::Normal) || (chipId != 0x60 && chipId != 0x58)) {
+            return false;
+        }
+        hasHumidity = chipId == 0x60;
+
+        uint8_t tp[24];
+        uint8_t hA1 = 0;
+        uint8_t hE1[7] = {};
+        const I2CRegisterRead calibration[] = {{0x88, tp, sizeof(tp)}, {0xA1, &hA1, 1}, {0xE1, hE1, sizeof(hE1)}};
+        if (!bus->readRegisters(address, calibration, hasHumidity ? 3 : 1, I2CPriority::Normal)) {
+            return false;
+        }
+
+        t1 = u16(tp);
+        t2 = s16(tp + 2);
+        t3 = s16(tp + 4);
+        p1 = u16(tp + 6);
+        p2 = s16(tp + 8);
+        p3 = s16(tp + 10);
+        p4 = s16(tp + 12);
+        p5 = s16(tp + 14);
+        p6 = s16(tp + 16);
+        p7 = s16(tp + 18);
+        p8 = s16(tp + 20);
+        p9 = s16(tp + 22);
+        h1 = hA1;
+        h2 = s16(hE1);
+        h3 = hE1[2];
+        h4 = static_cast<int16_t>((static_cast<int8_t>(hE1[3]) * 16) | (hE1[4] & 0x0F));
+        h5 = static_cast<int16_t>((static_cast<int8_t>(hE1[5]) * 16) | (hE1[4] >> 4));
+        h6 = static_cast<int8_t>(hE1[6]);
+
+        // Oversampling x1 everywhere, normal mode with 250 ms standby, no filter.
+        // ctrl_hum only takes effect after the ctrl_meas write.
+        return (!hasHumidity || writeRegister(0xF2, 0x01)) && writeRegister(0xF5, 0x60) && writeRegister(0xF4, 0x27);
+    }
+
+public:
+    Bme280Driver() : hasHumidity(false) {}
+
+    size_t sample(SensorValue *values) override {
+        uint8_t raw[8];
+        I2CRegisterRead read = {0xF7, raw, static_cast<uint8_t>(hasHumidity ? 8 : 6)};
+        if (!bus->readRegisters(address, &read, 1, I2CPriority::Normal)) {
+            return 0;
+        }
+
+        int32_t adcP = (raw[0] << 12) | (raw[1] << 4) | (raw[2] >> 4);
+        int32_t adcT = (raw[3] << 12) | (raw[4] << 4) | (raw[5] >> 4);
+
+        int32_t var1 = ((((adcT >> 3) - ((int32_t)t1 << 1))) * t2) >> 11;
+        int32_t var2 = (((((adcT >> 4) - t1) * ((adcT >> 4) - t1)) >> 12) * t3) >> 14;
+        int32_t tFine = var1 + var2;
+        values[0] = {"temperature", "C", ((tFine * 5 + 128) >> 8) / 100.0f};
+
+        int64_t pVar1 = (int64_t)tFine - 128000;
+        int64_t pVar2 = pVar1 * pVar1 * p6;
+        pVar2 += (pVar1 * p5) << 17;
+        pVar2 += (int64_t)p4 << 35;
+        pVar1 = ((pVar1 * pVar1 * p3) >> 8) + ((pVar1 * p2) << 12);
+        pVar1 = ((((int64_t)1 << 47) + pVar1) * p1) >> 33;
+        if (pVar1 == 0) {
+            return 0;
+        }
+        int64_t pressure = 1048576 - adcP;
+        pressure = (((pressure << 31) - pVar2) * 3125) / pVar1;
+        pVar1 = ((int64_t)p9 * (pressure >> 13) * (pressure >> 13)) >> 25;
+        pVar2 = ((int64_t)p8 * pressure) >> 19;
+        pressure = ((pressure + pVar1 + pVar2) >> 8) + ((int64_t)p7 << 4);
+        values[1] = {"pressure", "hPa", pressure / 25600.0f}; // Q24.8 pascals
+
+        if (!hasHumidity) {
+            return 2;
+        }
+
+        int32_t adcH = (raw[6] << 8) | raw[7];
+        int32_t h = tFine - 76800;
+        h = (((((adcH << 14) - ((int32_t)h4 << 20) - ((int32_t)h5 * h)) + 16384) >> 15) *
+             (((((((h * h6) >> 10) * (((h * (int32_t)h3) >> 11) + 32768)) >> 10) + 2097152) * h2 + 8192) >> 14));
+        h -= (((((h >> 15) * (h >> 15)) >> 7) * (int32_t)h1) >> 4);
+        h = constrain(h, 0, 419430400);
+        values[2] = {"humidity", "%", (h >> 12) / 1024.0f};
+        return 3;
+    }
+};
+
+// INA219: bus and shunt voltage, and the current through INA219_SHUNT_OHMS.
+// Reset defaults (32 V range, 320 mV shunt range, continuous) are kept.
+class Ina219Driver : public SensorDriver {
+protected:
+    bool configure() override {
+        // No ID register; the reset value of the configuration register has to do
+        uint8_t config[2];
+        I2CRegisterRead read = {0x00, config, sizeof(config)};
+        return bus->readRegisters(address, &read, 1, I2CPriority::Normal) && config[0] == 0x39 && config[1] == 0x9F;
+    }
+
+public:
+    size_t sample(SensorValue *values) override {
+        uint8_t shunt[2];
+        uint8_t busVoltage[2];
+        const I2CRegisterRead reads[] = {{0x01, shunt, sizeof(shunt)}, {0x02, busVoltage, sizeof(busVoltage)}};
+        if (!bus->readRegisters(address, reads, 2, I2CPriority::Normal)) {
+            return 0;
+        }
+
+        float shuntMv = static_cast<int16_t>((shunt[0] << 8) | shunt[1]) * 0.01f; // 10 uV per bit
+        float busV = (((busVoltage[0] << 8) | busVoltage[1]) >> 3) * 0.004f;     // 4 mV per bit
+        values[0] = {"busVoltage", "V", busV};
+        values[1] = {"shuntVoltage", "mV", shuntMv};
+        values[2] = {"current", "mA", shuntMv / INA219_SHUNT_OHMS};
+        return 3;
+    }
+};
+
+template <typename Driver>
+static SensorDriver *create() {
+    return new (std::nothrow) Driver();
+}
+
+struct DriverEntry {
+    const char *part; // As named in the i2c_devices registry
+    uint32_t intervalMs;
+    SensorDriver *(*create)();
+};
+
+static const DriverEntry DRIVERS[] = {
+    {"MCP9808", 1000, &create<Mcp9808Driver>},
+    {"BME280", 1000, &create<Bme280Driver>},
+    {"BMP280", 1000, &create<Bme280Driver>},
+    {"INA219", 250, &create<Ina219Driver>},
+};
+
+SensorDriver *createSensorDriver(const char *part, uint32_t &intervalMs) {
+    for (const DriverEntry &entry : DRIVERS) {
+        if (strcmp(entry.part, part) == 0) {
+            intervalMs = entry.intervalMs;
+            return entry.create();
+        }
+    }
+    return nullptr;
+}
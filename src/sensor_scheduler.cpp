@@ -0,0 +1,186 @@
+// sensor_scheduler.cpp
+#include "sensor_scheduler.h"
+#include "logger.h"
+
+SensorScheduler::SensorScheduler(I2CBus *bus, I2CScanner *scanner) :
+    bus(bus),
+    scanner(scanner),
+    task(nullptr),
+    mux(portMUX_INITIALIZER_UNLOCKED),
+    slots{},
+    slotCount(0),
+    attachedJob(0)
+{
+}
+
+void SensorScheduler::begin() {
+    // Drivers are attached by the task itself once a scan has finished
+    xTaskCreate(&SensorScheduler::sampleLoop, "sensors", SENSOR_TASK_STACK_SIZE, this, SENSOR_TASK_PRIORITY, &task);
+    LOG_INFO("Sensors", "Scheduler started");
+}
+
+void SensorScheduler::sampleLoop(void *arg) {
+    SensorScheduler *self = static_cast<SensorScheduler *>(arg);
+    TickType_t wake = xTaskGetTickCount();
+
+    for (;;) {
+        uint32_t job = self->scanner->getCompletedJob();
+        if (job != 0 && job != self->attachedJob) {
+            self->attach();
+            self->attachedJob = job;
+        }
+
+        self->sampleDue(millis());
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(SENSOR_TICK_MS));
+    }
+}
+
+// Brings the driver list in line with the last scan: drivers whose device is
+// gone, or is now confirmed to be another part, are dropped and new parts
+// attached. A guess by address alone (identify=0, or an ID register that did
+// not match) leaves a working driver in place.
+void SensorScheduler::attach() {
+    ScannedDevice devices[I2C_SCAN_MAX_IDENTIFIED];
+    size_t count = scanner->getDevices(devices, I2C_SCAN_MAX_IDENTIFIED);
+
+    for (size_t i = slotCount; i-- > 0;) {
+        const Snapshot &current = slots[i].snapshot;
+        bool present = false;
+        for (size_t j = 0; j < count && !present; j++) {
+            const i2c_devices::Device *device = i2c_devices::get(devices[j].identity.device);
+            present = devices[j].address == current.address &&
+                      (!devices[j].identity.confirmed || (device != nullptr && strcmp(device->part, current.part) == 0));
+        }
+        if (!present) {
+            LOG_INFO("Sensors", "Detached %s at 0x%02X", current.part, current.address);
+            detach(i);
+        }
+    }
+
+    for (size_t j = 0; j < count; j++) {
+        const i2c_devices::Device *device = i2c_devices::get(devices[j].identity.device);
+        if (device == nullptr) {
+            continue;
+        }
+
+        bool attached = false;
+        for (size_t i = 0; i < slotCount && !attached; i++) {
+            attached = slots[i].snapshot.address == devices[j].address;
+        }
+        if (attached) {
+            continue;
+        }
+
+        uint32_t intervalMs = 0;
+        SensorDriver *driver = createSensorDriver(device->part, intervalMs);
+        if (driver == nullptr) {
+            continue;
+        }
+        if (slotCount >= SENSOR_MAX_DEVICES) {
+            LOG_WARN("Sensors", "No slot left for %s at 0x%02X", device->part, devices[j].address);
+            delete driver;
+            break;
+        }
+        if (!driver->begin(bus, devices[j].address)) {
+            LOG_WARN("Sensors", "%s at 0x%02X did not answer setup", device->part, devices[j].address);
+            delete driver;
+            continue;
+        }
+
+        Slot slot = {};
+        slot.driver = driver;
+        slot.nextDue = millis() + (slotCount * SENSOR_TICK_MS) % intervalMs; // Stagger
+        slot.snapshot.address = devices[j].address;
+        slot.snapshot.part = device->part;
+        slot.snapshot.intervalMs = intervalMs;
+
+        portENTER_CRITICAL(&mux);
+        slots[slotCount++] = slot;
+        portEXIT_CRITICAL(&mux);
+
+        LOG_INFO("Sensors", "Attached %s at 0x%02X, every %u ms", device->part, devices[j].address, intervalMs);
+    }
+}
+
+void SensorScheduler::detach(size_t index) {
+    delete slots[index].driver;
+
+    portENTER_CRITICAL(&mux);
+    for (size_t i = index + 1; i < slotCount; i++) {
+        slots[i - 1] = slots[i];
+    }
+    slotCount--;
+    portEXIT_CRITICAL(&mux);
+}
+
+// Each due driver reads all of its registers in one bus acquisition
+void SensorScheduler::sampleDue(unsigned long now) {
+    for (size_t i = 0; i < slotCount; i++) {
+        Slot &slot = slots[i];
+        if ((long)(now - slot.nextDue) < 0) {
+            continue;
+        }
+
+        SensorValue values[SENSOR_MAX_VALUES];
+        size_t count = slot.driver->sample(values);
+
+        // Keep the phase so the stagger holds, unless a whole period was missed.
+        // intervalMs is only written while attaching, on this task.
+        uint32_t intervalMs = slot.snapshot.intervalMs;
+        slot.nextDue += intervalMs;
+        if ((long)(now - slot.nextDue) >= 0) {
+            slot.nextDue = now + intervalMs;
+        }
+
+        Snapshot &snapshot = slot.snapshot;
+        portENTER_CRITICAL(&mux);
+        if (count > 0) {
+            memcpy(snapshot.values, values, count * sizeof(SensorValue));
+            snapshot.valueCount = count;
+            snapshot.sampledAt = now;
+            snapshot.samples++;
+            snapshot.ok = true;
+        } else {
+            snapshot.failures++;
+            snapshot.ok = false;
+        }
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+void SensorScheduler::populateSensors(JsonArray &sensors) const {
+    // One slot at a time, so the critical section stays short
+    for (size_t i = 0;; i++) {
+        portENTER_CRITICAL(&mux);
+        if (i >= slotCount) {
+            portEXIT_CRITICAL(&mux);
+            break;
+        }
+        Snapshot slot = slots[i].snapshot;
+        portEXIT_CRITICAL(&mux);
+        unsigned long now = millis();
+
+        char hex[5];
+        snprintf(hex, sizeof(hex), "0x%02x", slot.address);
+
+        JsonObject sensor = sensors.add<JsonObject>();
+        sensor["address"] = slot.address;
+        sensor["hexAddress"] = hex;
+        sensor["part"] = slot.part;
+        sensor["intervalMs"] = slot.intervalMs;
+        sensor["ok"] = slot.ok;
+        sensor["samples"] = slot.samples;
+        sensor["failures"] = slot.failures;
+        if (slot.samples == 0) {
+            continue;
+        }
+
+        sensor["ageMs"] = now - slot.sampledAt;
+        JsonObject values = sensor["values"].to<JsonObject>();
+        for (size_t v = 0; v < slot.valueCount; v++) {
+            JsonObject reading = values[slot.values[v].name].to<JsonObject>();
+            reading["value"] = slot.values[v].value;
+            reading["unit"] = slot.values[v].unit;
+        }
+    }
+}
@@ -0,0 +1,240 @@
+#include <Arduino.h>
+#include "sequence_player.h"
+#include "logger.h"
+#include <hal/gpio_ll.h>
+#include <algorithm>
+
+SequencePlayer *SequencePlayer::instance = nullptr;
+
+SequencePlayer::SequencePlayer(DACControl *dacControl) :
+    dacControl(dacControl),
+    timer(nullptr),
+    timerMux(portMUX_INITIALIZER_UNLOCKED),
+    stepCount(0),
+    loop(false),
+    periodUs(0),
+    running(false),
+    nextStep(0),
+    cycleStartUs(0),
+    cyclesCompleted(0),
+    deviationCount(0),
+    minDeviation(0),
+    maxDeviation(0)
+{
+}
+
+void SequencePlayer::begin() {
+    instance = this;
+    timer = timerBegin(SEQUENCER_TIMER_NUM, SEQUENCER_TIMER_DIVIDER, true);
+    timerAttachInterrupt(timer, &SequencePlayer::onTimer, false);
+    dacControl->setSequenceTrigger(&SequencePlayer::onTrigger, this);
+    LOG_INFO("Sequencer", "Initialized");
+}
+
+void IRAM_ATTR SequencePlayer::onTrigger(void *context) {
+    static_cast<SequencePlayer *>(context)->startFromISR();
+}
+
+// Trigger path: the cycle starts at the edge, so a step at offset 0 is written
+// before this returns. A trigger during playback restarts the cycle.
+void IRAM_ATTR SequencePlayer::startFromISR() {
+    if (stepCount == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&timerMux);
+    nextStep = 0;
+    cycleStartUs = timerRead(timer);
+    running = true;
+    portEXIT_CRITICAL_ISR(&timerMux);
+
+    serviceTimer();
+}
+
+void IRAM_ATTR SequencePlayer::onTimer() {
+    if (instance != nullptr) {
+        instance->serviceTimer();
+    }
+}
+
+// Executes every step that is due, then re-arms the one-shot alarm for the next one
+void IRAM_ATTR SequencePlayer::serviceTimer() {
+    portENTER_CRITICAL_ISR(&timerMux);
+
+    while (running) {
+        uint64_t now = timerRead(timer);
+        uint64_t scheduled = cycleStartUs + steps[nextStep].offsetUs;
+        if (now < scheduled) {
+            timerAlarmWrite(timer, scheduled, false);
+            timerAlarmEnable(timer);
+            // An alarm set in the past never fires, so re-check after arming
+            if (timerRead(timer) < scheduled) {
+                break;
+            }
+            continue;
+        }
+
+        const SequenceStep &step = steps[nextStep];
+        if (!dacControl->writeFromISR(step.dacValue)) {
+            // Another output has taken the DAC over; give way instead of fighting it
+            running = false;
+            break;
+        }
+        gpio_ll_set_level(&GPIO, (gpio_num_t)LED_PIN, step.ledState);
+
+        int32_t deviation = (int32_t)(now - scheduled);
+        deviationHistory[deviationCount % SEQUENCE_JITTER_HISTORY] = deviation;
+        if (deviationCount == 0 || deviation < minDeviation) {
+            minDeviation = deviation;
+        }
+        if (deviationCount == 0 || deviation > maxDeviation) {
+            maxDeviation = deviation;
+        }
+        deviationCount++;
+
+        if (++nextStep >= stepCount) {
+            nextStep = 0;
+            cyclesCompleted++;
+            if (loop) {
+                cycleStartUs += periodUs;
+            } else {
+                running = false;
+            }
+        }
+    }
+
+    portEXIT_CRITICAL_ISR(&timerMux);
+}
+
+void SequencePlayer::resetStatistics() {
+    deviationCount = 0;
+    minDeviation = 0;
+    maxDeviation = 0;
+    cyclesCompleted = 0;
+}
+
+bool SequencePlayer::loadJSON(const String &json, String &error) {
+    if (running) {
+        error = "Sequence is running";
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError parseError = deserializeJson(doc, json);
+    if (parseError) {
+        error = String("JSON parsing failed: ") + parseError.c_str();
+        return false;
+    }
+
+    JsonArray program = doc["steps"].as<JsonArray>();
+    if (program.isNull() || program.size() == 0 || program.size() > MAX_SEQUENCE_STEPS) {
+        error = "steps must hold 1.." + String(MAX_SEQUENCE_STEPS) + " entries";
+        return false;
+    }
+
+    size_t count = 0;
+    uint32_t lastOffset = 0;
+    for (JsonArray entry : program) {
+        uint32_t offsetUs = entry[0] | 0UL;
+        if (count > 0 && offsetUs < lastOffset) {
+            error = "Step offsets must be ascending";
+            return false;
+        }
+        steps[count].offsetUs = offsetUs;
+        steps[count].dacValue = constrain(entry[1] | 0, 0, 255);
+        steps[count].ledState = (entry[2] | 0) ? 1 : 0;
+        lastOffset = offsetUs;
+        count++;
+    }
+
+    stepCount = count;
+    loop = doc["loop"] | false;
+    periodUs = doc["periodUs"] | (lastOffset + 1);
+    if (periodUs <= lastOffset) {
+        periodUs = lastOffset + 1;
+    }
+
+    LOG_INFO("Sequencer", "Loaded %u steps, %s, period %u us",
+             stepCount, loop ? "looping" : "one-shot", periodUs);
+    return true;
+}
+
+bool SequencePlayer::start() {
+    if (timer == nullptr || stepCount == 0) {
+        return false;
+    }
+
+    stop();
+
+    // The sequence owns the DAC while it plays
+    dacControl->stopWaveform();
+    pinMode(LED_PIN, OUTPUT);
+
+    timerAlarmDisable(timer);
+    timerWrite(timer, 0);
+
+    portENTER_CRITICAL(&timerMux);
+    resetStatistics();
+    nextStep = 0;
+    // Leave a little headroom before the first step so it is never already late
+    cycleStartUs = SEQUENCE_START_DELAY_US;
+    running = true;
+    portEXIT_CRITICAL(&timerMux);
+
+    timerAlarmWrite(timer, SEQUENCE_START_DELAY_US + steps[0].offsetUs, false);
+    timerAlarmEnable(timer);
+
+    LOG_INFO("Sequencer", "Started");
+    return true;
+}
+
+void SequencePlayer::stop() {
+    if (timer == nullptr) {
+        return;
+    }
+
+    timerAlarmDisable(timer);
+    portENTER_CRITICAL(&timerMux);
+    bool wasRunning = running;
+    running = false;
+    portEXIT_CRITICAL(&timerMux);
+
+    if (wasRunning) {
+        LOG_INFO("Sequencer", "Stopped");
+    }
+}
+
+bool SequencePlayer::isRunning() const {
+    return running;
+}
+
+void SequencePlayer::populateStatus(JsonObject root) const {
+    root["running"] = (bool)running;
+    root["steps"] = stepCount;
+    root["loop"] = loop;
+    root["periodUs"] = periodUs;
+    root["cycles"] = (uint32_t)cyclesCompleted;
+    root["nextStep"] = (uint32_t)nextStep;
+
+    // Snapshot the history, then work out percentiles outside the ISR's reach
+    static int32_t sorted[SEQUENCE_JITTER_HISTORY];
+    portMUX_TYPE *mux = const_cast<portMUX_TYPE *>(&timerMux);
+    portENTER_CRITICAL(mux);
+    uint32_t total = deviationCount;
+    size_t samples = min<uint32_t>(total, SEQUENCE_JITTER_HISTORY);
+    memcpy(sorted, deviationHistory, samples * sizeof(int32_t));
+    int32_t minimum = minDeviation;
+    int32_t maximum = maxDeviation;
+    portEXIT_CRITICAL(mux);
+
+    JsonObject jitter = root["jitterUs"].to<JsonObject>();
+    jitter["count"] = total;
+    if (samples > 0) {
+        std::sort(sorted, sorted + samples);
+        jitter["min"] = minimum;
+        jitter["max"] = maximum;
+        jitter["p50"] = sorted[samples / 2];
+        jitter["p99"] = sorted[min<size_t>(samples - 1, (samples * 99) / 100)];
+        jitter["window"] = samples;
+    }
+}
@@ -0,0 +1,127 @@
+// static_assets.cpp
+#include "static_assets.h"
+#include "logger.h"
+#include <SPIFFS.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <new>
+
+StaticAssets::StaticAssets() :
+    bytesCached(0),
+    hits(0),
+    misses(0)
+{
+}
+
+StaticAssets::~StaticAssets() {
+    for (StaticAsset &asset : assets) {
+        delete[] asset.data;
+    }
+}
+
+// Needs SPIFFS mounted. Without a manifest every lookup misses and files are served as stored.
+bool StaticAssets::begin() {
+    File file = SPIFFS.open("/assets.json", "r");
+    if (!file) {
+        LOG_WARN("Assets", "No /assets.json, serving uncompressed files");
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        LOG_ERROR("Assets", "Manifest parsing failed: %s", error.c_str());
+        return false;
+    }
+
+    for (JsonPair entry : doc.as<JsonObject>()) {
+        StaticAsset asset;
+        asset.path = entry.key().c_str();
+        asset.etag = "\"" + entry.value()["etag"].as<String>() + "\"";
+        asset.immutable = entry.value()["immutable"] | false;
+        asset.data = nullptr;
+        asset.size = 0;
+        asset.uncacheable = false;
+        assets.push_back(asset);
+    }
+    std::sort(assets.begin(), assets.end(),
+              [](const StaticAsset &a, const StaticAsset &b) { return a.path < b.path; });
+
+    LOG_INFO("Assets", "%u gzipped assets in manifest", assets.size());
+    return true;
+}
+
+StaticAsset *StaticAssets::find(const String &path) {
+    auto it = std::lower_bound(assets.begin(), assets.end(), path,
+                               [](const StaticAsset &asset, const String &key) { return asset.path < key; });
+    return (it != assets.end() && it->path == path) ? &*it : nullptr;
+}
+
+size_t StaticAssets::count() const {
+    return assets.size();
+}
+
+const uint8_t *StaticAssets::getCachedData(StaticAsset &asset) {
+    if (asset.data != nullptr) {
+        hits++;
+        return asset.data;
+    }
+
+    misses++;
+    if (asset.uncacheable) {
+        return nullptr;
+    }
+
+    File file = SPIFFS.open(asset.path + ".gz", "r");
+    if (!file) {
+        return nullptr;
+    }
+
+    size_t size = file.size();
+    if (size == 0 || size > ASSET_CACHE_MAX_FILE || bytesCached + size > ASSET_CACHE_BUDGET) {
+        // Decided once; the budget is only ever filled, never evicted
+        asset.uncacheable = true;
+        file.close();
+        return nullptr;
+    }
+
+    uint8_t *data = new (std::nothrow) uint8_t[size];
+    if (data == nullptr) {
+        file.close();
+        return nullptr;
+    }
+    if (file.read(data, size) != size) {
+        delete[] data;
+        file.close();
+        return nullptr;
+    }
+    file.close();
+
+    asset.data = data;
+    asset.size = size;
+    bytesCached += size;
+    LOG_INFO("Assets", "Cached %s (%u bytes, %u/%u used)", asset.path.c_str(), size, bytesCached,
+             ASSET_CACHE_BUDGET);
+    return asset.data;
+}
+
+void StaticAssets::populateStats(JsonObject root) const {
+    root["assets"] = assets.size();
+    root["hits"] = hits;
+    root["misses"] = misses;
+    root["bytesCached"] = bytesCached;
+    root["budget"] = ASSET_CACHE_BUDGET;
+    root["maxFileSize"] = ASSET_CACHE_MAX_FILE;
+    root["freeHeap"] = ESP.getFreeHeap();
+
+    JsonArray files = root["files"].to<JsonArray>();
+    for (const StaticAsset &asset : assets) {
+        JsonObject entry = files.add<JsonObject>();
+        entry["path"] = asset.path;
+        entry["cached"] = asset.data != nullptr;
+        if (asset.data != nullptr) {
+            entry["size"] = asset.size;
+        }
+    }
+}
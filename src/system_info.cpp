@@ -102,36 +102,30 @@ String SystemInfo::getBoardInfoJSON() {
 
 String SystemInfo::getCompleteSystemInfoJSON() {
   JsonDocument doc;
+  JsonObject root = doc.to<JsonObject>();
+  populateSystemInfo(root);
   
+  String jsonString;
+  serializeJson(doc, jsonString);
+  return jsonString;
+}
+
+void SystemInfo::populateSystemInfo(JsonObject& root) {
   // Create nested objects and populate them directly
-  JsonObject network = doc.createNestedObject("network");
+  JsonObject network = root["network"].to<JsonObject>();
   populateNetworkInfo(network);
   
-  JsonObject resources = doc.createNestedObject("resources");
+  JsonObject resources = root["resources"].to<JsonObject>();
   populateResourceInfo(resources);
   
-  JsonObject board = doc.createNestedObject("board");
+  JsonObject board = root["board"].to<JsonObject>();
   populateBoardInfo(board);
   
-  // Add battery info if available - SIMPLIFIED APPROACH
+  // Add battery info if available
   if (batteryManager) {
-    // Get battery info as JSON string
-    String batteryJson = batteryManager->getBatteryInfoJSON();
-    
-    // Parse the JSON string into a temporary document
-    JsonDocument tempDoc;
-    deserializeJson(tempDoc, batteryJson);
-    
-    // Create the battery object in main document and copy values
-    JsonObject battery = doc.createNestedObject("battery");
-    for (JsonPair kv : tempDoc.as<JsonObject>()) {
-      battery[kv.key()] = kv.value();
-    }
+    JsonObject battery = root["battery"].to<JsonObject>();
+    batteryManager->populateBatteryInfo(battery);
   }
-  
-  String jsonString;
-  serializeJson(doc, jsonString);
-  return jsonString;
 }
 
 void SystemInfo::populateNetworkInfo(JsonObject& network) {
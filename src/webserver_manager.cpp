@@ -3,241 +3,1578 @@
 #include "webserver_manager.h"
 #include "ethernet_controller.h"
 #include "config.h"
+#include "logger.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include <lwip/sockets.h>
+
+WebServerManager *WebServerManager::instance = nullptr;
 
 WebServerManager::WebServerManager(int port, DHTSensor *dhtSensor, DACControl *dacControl,
-                                   I2CScanner *i2cScanner, SystemInfo *systemInfo,
-                                   BatteryManager *batteryManager,
-                                   EthernetController *ethernetController) : server(port),
+                                   I2CScanner *i2cScanner, I2CBus *i2cBus, SensorScheduler *sensorScheduler,
+                                   SystemInfo *systemInfo,
+                                   BatteryManager *batteryManager, SequencePlayer *sequencePlayer,
+                                   DacFeedbackLoop *feedbackLoop, LiveState *liveState,
+                                   EthernetController *ethernetController) : server(nullptr),
+                                                                     port(port),
+                                                                     controlMutex(nullptr),
                                                                      dhtSensor(dhtSensor),
                                                                      dacControl(dacControl),
                                                                      i2cScanner(i2cScanner),
+                                                                     i2cBus(i2cBus),
+                                                                     sensorScheduler(sensorScheduler),
                                                                      systemInfo(systemInfo),
                                                                      batteryManager(batteryManager),
-                                                                     ethernetController(ethernetController)
+                                                                     sequencePlayer(sequencePlayer),
+                                                                     feedbackLoop(feedbackLoop),
+                                                                     liveState(liveState),
+                                                                     ethernetController(ethernetController),
+                                                                     lastStatePublish(0),
+                                                                     publishedVersion(0),
+                                                                     subscriberCount(0),
+                                                                     lastEventTick(0),
+                                                                     lastIdleSweep(0),
+                                                                     connectionsOpened(0),
+                                                                     requestsServed(0),
+                                                                     idleClosed(0),
+                                                                     limitClosed(0),
+                                                                     streamFormat16(false),
+                                                                     streamHasCarry(false),
+                                                                     streamUploadStatus(200),
+                                                                     streamUploadError(nullptr)
+{
+    // Constructor body can be empty or have initialization code
+}
+
+void WebServerManager::begin()
+{
+    instance = this;
+    controlMutex = xSemaphoreCreateMutex();
+    staticAssets.begin();
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    config.stack_size = HTTP_SERVER_STACK_SIZE;
+    config.task_priority = HTTP_SERVER_PRIORITY;
+    config.max_open_sockets = HTTP_MAX_OPEN_SOCKETS;
+    config.max_uri_handlers = HTTP_MAX_URI_HANDLERS;
+    // "/*" catches every path; dispatch() picks the handler from the route table
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    // When every socket is busy, drop the least recently used one instead of refusing
+    config.lru_purge_enable = true;
+    // Connections stay open between requests; open_fn attaches the keep-alive bookkeeping
+    config.open_fn = &WebServerManager::onSocketOpen;
+    config.close_fn = &WebServerManager::onSocketClose;
+
+    if (httpd_start(&server, &config) != ESP_OK)
+    {
+        LOG_ERROR("WebServer", "Failed to start HTTP server");
+        return;
+    }
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    // Live state push; without WebSocket support in the core the UI keeps polling
+    httpd_uri_t webSocket = {};
+    webSocket.uri = "/ws";
+    webSocket.method = HTTP_GET;
+    webSocket.handler = &WebServerManager::handleWebSocket;
+    webSocket.user_ctx = this;
+    webSocket.is_websocket = true;
+    httpd_register_uri_handler(server, &webSocket);
+#endif
+
+    // One wildcard registration per method used in the table, after /ws so that matches first
+    RouteTable table = routeTable();
+    uint32_t registeredMethods = 0;
+    for (size_t i = 0; i < table.count; i++)
+    {
+        uint32_t methodBit = 1UL << table.routes[i].method;
+        if (registeredMethods & methodBit)
+        {
+            continue;
+        }
+        registeredMethods |= methodBit;
+
+        httpd_uri_t wildcard = {};
+        wildcard.uri = "/*";
+        wildcard.method = table.routes[i].method;
+        wildcard.handler = &WebServerManager::dispatch;
+        wildcard.user_ctx = this;
+        httpd_register_uri_handler(server, &wildcard);
+    }
+
+    LOG_INFO("WebServer", "Web server started");
+}
+
+// Error bodies go through the document path too, so binary clients can decode them
+static void sendError(HttpRequest &request, int code, const String &error)
+{
+    JsonDocument doc;
+    doc["error"] = error;
+    request.send(code, doc);
+}
+
+// The same for the routes whose clients look for a success flag
+static void sendFailure(HttpRequest &request, int code, const String &error)
+{
+    JsonDocument doc;
+    doc["success"] = false;
+    doc["error"] = error;
+    request.send(code, doc);
+}
+
+// Orders a request path (not null-terminated, it stops before the query) against a table path
+static constexpr int comparePath(const char *path, size_t length, const char *routePath)
+{
+    size_t i = 0;
+    for (; i < length && routePath[i] != '\0'; i++)
+    {
+        if (path[i] != routePath[i])
+        {
+            return static_cast<unsigned char>(path[i]) - static_cast<unsigned char>(routePath[i]);
+        }
+    }
+    if (i < length)
+    {
+        return 1;
+    }
+    return routePath[i] == '\0' ? 0 : -1;
+}
+
+static constexpr size_t pathLength(const char *path)
+{
+    size_t length = 0;
+    while (path[length] != '\0')
+    {
+        length++;
+    }
+    return length;
+}
+
+// Sorted by path, then method, with no duplicates
+template <typename Route, size_t N>
+static constexpr bool routesSorted(const Route (&routes)[N])
+{
+    for (size_t i = 1; i < N; i++)
+    {
+        int order = comparePath(routes[i].path, pathLength(routes[i].path), routes[i - 1].path);
+        if (order < 0 || (order == 0 && routes[i].method <= routes[i - 1].method))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The single list of routes: dispatch looks handlers up here and /debug lists it
+WebServerManager::RouteTable WebServerManager::routeTable()
+{
+    static constexpr Route ROUTES[] = {
+        {"/", HTTP_GET, &WebServerManager::handleRoot, "text/html"},
+        {"/api/ethernet/status", HTTP_GET, &WebServerManager::handleEthernetStatus, "application/json"},
+        {"/api/sensors", HTTP_GET, &WebServerManager::handleApiSensors, "application/json"},
+        {"/api/state", HTTP_GET, &WebServerManager::handleApiState, "application/json"},
+#ifndef WEB_DEBUG_ASSETS
+        // Release image: every module in one bundle, the stylesheet inlined into index.html
+        {"/app.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/assets", HTTP_GET, &WebServerManager::handleAssetStats, "application/json"},
+        {"/clients", HTTP_GET, &WebServerManager::handleClients, "text/plain"},
+#ifdef WEB_DEBUG_ASSETS
+        // Debug image: the individual, unminified modules
+        {"/controlModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/dac", HTTP_GET, &WebServerManager::handleDAC, "text/plain"},
+        {"/dac/calibration", HTTP_GET, &WebServerManager::handleCalibration, "application/json"},
+        {"/dac/calibration", HTTP_POST, &WebServerManager::handleCalibrationSave, "application/json"},
+        {"/dac/loop", HTTP_GET, &WebServerManager::handleFeedbackLoop, "application/json"},
+        {"/dac/ramp", HTTP_GET, &WebServerManager::handleDACRamp, "application/json"},
+        {"/dac/stats", HTTP_GET, &WebServerManager::handleDACStats, "application/json"},
+        {"/dac/stream", HTTP_GET, &WebServerManager::handleStreamStatus, "application/json"},
+        {"/dac/stream", HTTP_POST, &WebServerManager::handleStreamUpload, "application/json", true},
+        {"/dac/voltage", HTTP_GET, &WebServerManager::handleDACVoltage, "application/json"},
+        {"/dacstate", HTTP_GET, &WebServerManager::handleDACState, "text/plain"},
+        {"/dds", HTTP_GET, &WebServerManager::handleDDS, "application/json"},
+        {"/dds/sweep", HTTP_GET, &WebServerManager::handleSweep, "application/json"},
+        {"/debug", HTTP_GET, &WebServerManager::handleDebug, "text/html"},
+        {"/ethernet/config", HTTP_POST, &WebServerManager::handleEthernetConfig, "application/json"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/ethernetModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/events", HTTP_GET, &WebServerManager::handleEvents, "text/event-stream"},
+        {"/generator", HTTP_GET, &WebServerManager::handleGenerator, "application/json"},
+        {"/i2c/bus", HTTP_GET, &WebServerManager::handleI2CBus, "application/json"},
+        {"/led", HTTP_GET, &WebServerManager::handleLED, "text/plain"},
+        {"/ledstate", HTTP_GET, &WebServerManager::handleLEDState, "text/plain"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/liveModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/log", HTTP_GET, &WebServerManager::handleLog, "application/json"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/main.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/scan", HTTP_GET, &WebServerManager::handleScan, "application/json"},
+        {"/scan/status", HTTP_GET, &WebServerManager::handleScanStatus, "application/json"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/scannerModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/sensor", HTTP_GET, &WebServerManager::handleSensor, "application/json"},
+        {"/sequence", HTTP_GET, &WebServerManager::handleSequenceStatus, "application/json"},
+        {"/sequence", HTTP_POST, &WebServerManager::handleSequenceLoad, "application/json"},
+        {"/sequence/start", HTTP_GET, &WebServerManager::handleSequenceStart, "application/json"},
+        {"/sequence/stop", HTTP_GET, &WebServerManager::handleSequenceStop, "application/json"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/style.css", HTTP_GET, &WebServerManager::handleCSS, "text/css"},
+        {"/sysInfoModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/sysinfo", HTTP_GET, &WebServerManager::handleSystemInfo, "application/json"},
+#ifdef WEB_DEBUG_ASSETS
+        {"/tabModule.js", HTTP_GET, &WebServerManager::handleJavaScriptFile, "application/javascript"},
+#endif
+        {"/trigger", HTTP_GET, &WebServerManager::handleTrigger, "application/json"},
+        {"/waveform", HTTP_GET, &WebServerManager::handleWaveform, "application/json"},
+        {"/waveform/stop", HTTP_GET, &WebServerManager::handleWaveformStop, "application/json"},
+    };
+    static_assert(routesSorted(ROUTES), "ROUTES must be sorted by path, then method");
+
+    return {ROUTES, sizeof(ROUTES) / sizeof(ROUTES[0])};
+}
+
+// Binary search for the first entry with this path, then a scan over its methods.
+// pathKnown tells 405 from 404 when the method is missing.
+const WebServerManager::Route *WebServerManager::findRoute(const char *uri, httpd_method_t method, bool &pathKnown)
+{
+    RouteTable table = routeTable();
+    size_t length = strcspn(uri, "?#");
+
+    size_t low = 0;
+    size_t high = table.count;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (comparePath(uri, length, table.routes[middle].path) > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    pathKnown = false;
+    for (size_t i = low; i < table.count && comparePath(uri, length, table.routes[i].path) == 0; i++)
+    {
+        pathKnown = true;
+        if (table.routes[i].method == method)
+        {
+            return &table.routes[i];
+        }
+    }
+    return nullptr;
+}
+
+// Runs on the server task. Handlers share the DAC, sequencer and sensor objects
+// with loop(), so each one runs under the control lock.
+esp_err_t WebServerManager::dispatch(httpd_req_t *req)
+{
+    WebServerManager *manager = static_cast<WebServerManager *>(req->user_ctx);
+    HttpRequest request(req);
+
+    // The last request a connection may make is told so, then the socket is closed
+    ConnectionState *connection = static_cast<ConnectionState *>(req->sess_ctx);
+    bool lastRequest = false;
+    if (connection != nullptr)
+    {
+        connection->lastActive = millis();
+        connection->requests++;
+        lastRequest = connection->requests >= HTTP_MAX_KEEPALIVE_REQUESTS;
+    }
+    if (lastRequest)
+    {
+        request.sendHeader("Connection", "close");
+    }
+    manager->requestsServed++;
+
+    bool pathKnown = false;
+    const Route *route = findRoute(req->uri, static_cast<httpd_method_t>(req->method), pathKnown);
+    if (route == nullptr)
+    {
+        request.send(pathKnown ? 405 : 404, "text/plain", (pathKnown ? "Method not allowed: " : "Not found: ") + request.path());
+    }
+    else if (route->selfLocking)
+    {
+        (manager->*(route->handler))(request);
+    }
+    else
+    {
+        xSemaphoreTake(manager->controlMutex, portMAX_DELAY);
+        (manager->*(route->handler))(request);
+        xSemaphoreGive(manager->controlMutex);
+    }
+
+    if (!request.hasResponded())
+    {
+        request.send(500, "text/plain", "No response from handler");
+    }
+
+    if (connection != nullptr)
+    {
+        // Long uploads count as activity up to the moment they finish
+        connection->lastActive = millis();
+    }
+    if (lastRequest && !manager->isSubscriber(request.socket()))
+    {
+        httpd_sess_trigger_close(req->handle, request.socket());
+        manager->limitClosed++;
+    }
+    return ESP_OK;
+}
+
+// The feedback loop and the sequencer both write the DAC on their own; a
+// handler about to drive it some other way stops them first
+void WebServerManager::takeDacOutput()
+{
+    feedbackLoop->disable();
+    sequencePlayer->stop();
+}
+
+bool WebServerManager::tryLockControl()
+{
+    return controlMutex == nullptr || xSemaphoreTake(controlMutex, 0) == pdTRUE;
+}
+
+void WebServerManager::unlockControl()
+{
+    if (controlMutex != nullptr)
+    {
+        xSemaphoreGive(controlMutex);
+    }
+}
+
+void WebServerManager::publishState()
+{
+    if (server == nullptr || millis() - lastStatePublish < STATE_PUBLISH_INTERVAL)
+    {
+        return;
+    }
+    lastStatePublish = millis();
+
+    if (!tryLockControl())
+    {
+        return;
+    }
+    uint32_t changed = refreshState();
+    String message = changed ? stateMessage(changed) : String();
+    unlockControl();
+
+    if (changed)
+    {
+        broadcast(message);
+    }
+}
+
+// Re-reads the state and returns what WebSocket clients have not been sent yet.
+// /api/state refreshes too, so changes are tracked by version rather than by
+// whichever caller happened to see them first. Call with the control lock held.
+uint32_t WebServerManager::refreshState()
+{
+    liveState->refresh();
+    uint32_t changed = liveState->changedSince(publishedVersion);
+    publishedVersion = liveState->getVersion();
+    return changed;
+}
+
+// {"version":n, ...changed groups...}, the same groups a full snapshot has
+void WebServerManager::stateDocument(JsonDocument &doc, uint32_t fields)
+{
+    JsonObject root = doc.to<JsonObject>();
+    root["version"] = liveState->getVersion();
+    liveState->toJSON(root, fields);
+}
+
+String WebServerManager::stateMessage(uint32_t fields)
+{
+    JsonDocument doc;
+    stateDocument(doc, fields);
+
+    String message;
+    serializeJson(doc, message);
+    return message;
+}
+
+struct StateBroadcast
+{
+    httpd_handle_t server;
+    String message;
+};
+
+// Sockets belong to the server task, so the send is queued onto it
+void WebServerManager::broadcast(const String &message)
+{
+    StateBroadcast *work = new StateBroadcast{server, message};
+    if (httpd_queue_work(server, &WebServerManager::sendBroadcast, work) != ESP_OK)
+    {
+        delete work;
+    }
+}
+
+void WebServerManager::sendBroadcast(void *arg)
+{
+    StateBroadcast *work = static_cast<StateBroadcast *>(arg);
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    size_t count = HTTP_MAX_OPEN_SOCKETS;
+    int sockets[HTTP_MAX_OPEN_SOCKETS];
+    if (httpd_get_client_list(work->server, &count, sockets) == ESP_OK)
+    {
+        httpd_ws_frame_t frame = {};
+        frame.type = HTTPD_WS_TYPE_TEXT;
+        frame.payload = (uint8_t *)work->message.c_str();
+        frame.len = work->message.length();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (httpd_ws_get_fd_info(work->server, sockets[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+            {
+                httpd_ws_send_frame_async(work->server, sockets[i], &frame);
+            }
+        }
+    }
+#endif
+
+    delete work;
+}
+
+esp_err_t WebServerManager::handleWebSocket(httpd_req_t *req)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    WebServerManager *manager = static_cast<WebServerManager *>(req->user_ctx);
+    httpd_ws_frame_t frame = {};
+
+    if (req->method == HTTP_GET)
+    {
+        // Handshake done: start the client off with the full state
+        xSemaphoreTake(manager->controlMutex, portMAX_DELAY);
+        String message = manager->stateMessage(STATE_ALL);
+        xSemaphoreGive(manager->controlMutex);
+
+        frame.type = HTTPD_WS_TYPE_TEXT;
+        frame.payload = (uint8_t *)message.c_str();
+        frame.len = message.length();
+        return httpd_ws_send_frame(req, &frame);
+    }
+
+    // First call only reads the frame header to learn the length
+    esp_err_t result = httpd_ws_recv_frame(req, &frame, 0);
+    if (result != ESP_OK || frame.len == 0)
+    {
+        return result;
+    }
+    if (frame.len > WS_MAX_MESSAGE_SIZE)
+    {
+        // Closes the socket
+        return ESP_FAIL;
+    }
+
+    uint8_t payload[WS_MAX_MESSAGE_SIZE + 1];
+    frame.payload = payload;
+    result = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+    payload[frame.len] = '\0';
+
+    if (frame.type == HTTPD_WS_TYPE_TEXT)
+    {
+        xSemaphoreTake(manager->controlMutex, portMAX_DELAY);
+        manager->handleWebSocketCommand((const char *)payload);
+        xSemaphoreGive(manager->controlMutex);
+    }
+    return ESP_OK;
+#else
+    return ESP_FAIL;
+#endif
+}
+
+// Commands: {"led":0|1} and/or {"dac":0-255}. The resulting change reaches every
+// client, this one included, with the next state push.
+void WebServerManager::handleWebSocketCommand(const char *message)
+{
+    JsonDocument doc;
+    if (deserializeJson(doc, message))
+    {
+        LOG_WARN("WebServer", "Ignoring malformed WebSocket command");
+        return;
+    }
+
+    if (doc["led"].is<int>())
+    {
+        digitalWrite(LED_PIN, doc["led"].as<int>() ? HIGH : LOW);
+    }
+    if (doc["dac"].is<int>())
+    {
+        takeDacOutput();
+        dacControl->requestValue(constrain(doc["dac"].as<int>(), 0, 255));
+    }
+}
+
+void WebServerManager::publishEvents()
+{
+    if (server == nullptr || subscriberCount == 0 || millis() - lastEventTick < SSE_TICK_INTERVAL)
+    {
+        return;
+    }
+    lastEventTick = millis();
+    httpd_queue_work(server, &WebServerManager::sendEvents, this);
+}
+
+// One snapshot per tick, serialized once and written to every subscriber that is due
+void WebServerManager::sendEvents(void *arg)
+{
+    WebServerManager *manager = static_cast<WebServerManager *>(arg);
+    unsigned long now = millis();
+
+    bool due = false;
+    for (size_t i = 0; i < manager->subscriberCount; i++)
+    {
+        due = due || (long)(now - manager->subscribers[i].nextDue) >= 0;
+    }
+    if (!due)
+    {
+        return;
+    }
+
+    xSemaphoreTake(manager->controlMutex, portMAX_DELAY);
+    String message = manager->eventMessage();
+    xSemaphoreGive(manager->controlMutex);
+
+    for (size_t i = 0; i < manager->subscriberCount;)
+    {
+        EventSubscriber &subscriber = manager->subscribers[i];
+        if ((long)(now - subscriber.nextDue) < 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (httpd_socket_send(manager->server, subscriber.socket, message.c_str(), message.length(), 0) < 0)
+        {
+            // Gone without the server noticing yet; closing it also drops the subscriber
+            httpd_sess_trigger_close(manager->server, subscriber.socket);
+            manager->removeSubscriber(subscriber.socket);
+            continue;
+        }
+
+        // Keep the cadence, but do not try to catch up after a stall
+        subscriber.nextDue += subscriber.intervalMs;
+        if ((long)(now - subscriber.nextDue) >= 0)
+        {
+            subscriber.nextDue = now + subscriber.intervalMs;
+        }
+        i++;
+    }
+}
+
+// event: telemetry, data: the /sysinfo document plus the sensor reading
+String WebServerManager::eventMessage()
+{
+    JsonDocument doc;
+    JsonObject root = doc.to<JsonObject>();
+    systemInfo->populateSystemInfo(root);
+
+    JsonObject sensor = root["sensor"].to<JsonObject>();
+    sensor["ready"] = dhtSensor->isReady();
+    sensor["temperature"] = dhtSensor->getTemperature();
+    sensor["humidity"] = dhtSensor->getHumidity();
+
+    String data;
+    serializeJson(doc, data);
+    return "event: telemetry\ndata: " + data + "\n\n";
+}
+
+void WebServerManager::removeSubscriber(int socket)
+{
+    for (size_t i = 0; i < subscriberCount; i++)
+    {
+        if (subscribers[i].socket == socket)
+        {
+            subscribers[i] = subscribers[subscriberCount - 1];
+            subscriberCount--;
+            LOG_INFO("WebServer", "Event subscriber on socket %d closed", socket);
+            return;
+        }
+    }
+}
+
+bool WebServerManager::isSubscriber(int socket) const
+{
+    for (size_t i = 0; i < subscriberCount; i++)
+    {
+        if (subscribers[i].socket == socket)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs on the server task for every accepted connection
+esp_err_t WebServerManager::onSocketOpen(httpd_handle_t handle, int socket)
+{
+    // The response head and body go out in separate writes; with Nagle on, a reused
+    // connection stalls on the client's delayed ACK for every request
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    ConnectionState *connection = new ConnectionState{millis(), 0};
+    httpd_sess_set_ctx(handle, socket, connection, &WebServerManager::freeConnection);
+    if (instance != nullptr)
+    {
+        instance->connectionsOpened++;
+    }
+    return ESP_OK;
+}
+
+void WebServerManager::freeConnection(void *context)
+{
+    delete static_cast<ConnectionState *>(context);
+}
+
+void WebServerManager::sweepConnections()
+{
+    if (server == nullptr || millis() - lastIdleSweep < HTTP_IDLE_SWEEP_INTERVAL)
+    {
+        return;
+    }
+    lastIdleSweep = millis();
+    httpd_queue_work(server, &WebServerManager::closeIdleConnections, this);
+}
+
+// Keep-alive sockets hold one of HTTP_MAX_OPEN_SOCKETS slots while idle, so
+// quiet ones are closed. Event streams and WebSockets are quiet on the request
+// side by design and are left alone.
+void WebServerManager::closeIdleConnections(void *arg)
+{
+    WebServerManager *manager = static_cast<WebServerManager *>(arg);
+
+    size_t count = HTTP_MAX_OPEN_SOCKETS;
+    int sockets[HTTP_MAX_OPEN_SOCKETS];
+    if (httpd_get_client_list(manager->server, &count, sockets) != ESP_OK)
+    {
+        return;
+    }
+
+    unsigned long now = millis();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (manager->isSubscriber(sockets[i]))
+        {
+            continue;
+        }
+#if CONFIG_HTTPD_WS_SUPPORT
+        if (httpd_ws_get_fd_info(manager->server, sockets[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+        {
+            continue;
+        }
+#endif
+
+        ConnectionState *connection = static_cast<ConnectionState *>(httpd_sess_get_ctx(manager->server, sockets[i]));
+        if (connection != nullptr && now - connection->lastActive >= HTTP_IDLE_TIMEOUT)
+        {
+            httpd_sess_trigger_close(manager->server, sockets[i]);
+            manager->idleClosed++;
+        }
+    }
+}
+
+// Runs on the server task for every closed session, before the descriptor can be reused
+void WebServerManager::onSocketClose(httpd_handle_t handle, int socket)
+{
+    if (instance != nullptr)
+    {
+        instance->removeSubscriber(socket);
+    }
+    close(socket);
+}
+
+// Helper function to serve files from SPIFFS. Assets from the generated image are
+// sent pre-gzipped with an ETag, from RAM once cached; a matching If-None-Match
+// gets an empty 304.
+void WebServerManager::serveFile(HttpRequest &request, const String &path, const char *contentType)
+{
+    StaticAsset *asset = staticAssets.find(path);
+    if (asset != nullptr)
+    {
+        request.sendHeader("ETag", asset->etag);
+        request.sendHeader("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+
+        if (request.header("If-None-Match").indexOf(asset->etag) >= 0)
+        {
+            request.send(304, contentType, String());
+            return;
+        }
+
+        const uint8_t *cached = staticAssets.getCachedData(*asset);
+        if (cached != nullptr)
+        {
+            request.sendHeader("Content-Encoding", "gzip");
+            request.send(200, contentType, cached, asset->size);
+            return;
+        }
+
+        File file = SPIFFS.open(path + ".gz", "r");
+        if (file)
+        {
+            request.sendHeader("Content-Encoding", "gzip");
+            request.streamFile(file, contentType);
+            file.close();
+            return;
+        }
+    }
+
+    if (SPIFFS.exists(path))
+    {
+        File file = SPIFFS.open(path, "r");
+        request.streamFile(file, contentType);
+        file.close();
+    }
+    else
+    {
+        request.send(404, "text/plain", "File not found: " + path);
+        LOG_WARN("WebServer", "File not found: %s", path.c_str());
+    }
+}
+
+// Route handlers
+void WebServerManager::handleAssetStats(HttpRequest &request)
+{
+    JsonDocument doc;
+    staticAssets.populateStats(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleRoot(HttpRequest &request)
+{
+    serveFile(request, "/index.html", "text/html");
+}
+
+void WebServerManager::handleCSS(HttpRequest &request)
+{
+    serveFile(request, "/style.css", "text/css");
+}
+
+// Module routes share this handler; the file is named by the request path
+void WebServerManager::handleJavaScriptFile(HttpRequest &request)
+{
+    serveFile(request, request.path(), "application/javascript");
+}
+
+void WebServerManager::handleLED(HttpRequest &request)
+{
+    String state;
+    if (request.hasArg("state"))
+    {
+        state = request.arg("state");
+        digitalWrite(LED_PIN, state.toInt());
+        LOG_DEBUG("WebServer", "LED state set to: %s", state.c_str());
+    }
+    request.send(200, "text/plain", "LED state set to " + state);
+}
+
+void WebServerManager::handleLEDState(HttpRequest &request)
+{
+    String state = String(digitalRead(LED_PIN));
+    LOG_DEBUG("WebServer", "LED state requested: %s", state.c_str());
+    request.send(200, "text/plain", state);
+}
+
+void WebServerManager::handleDAC(HttpRequest &request)
+{
+    if (request.hasArg("value"))
+    {
+        // Hand the setpoint to the mailbox and answer right away; the main loop
+        // applies only the latest value, so rapid slider drags cannot pile up here
+        int value = constrain(request.arg("value").toInt(), 0, 255);
+        takeDacOutput();
+        dacControl->requestValue(value);
+        request.send(200, "text/plain", String(value));
+        return;
+    }
+    request.send(200, "text/plain", String(dacControl->getValue()));
+}
+
+void WebServerManager::handleDACState(HttpRequest &request)
+{
+    int value = dacControl->getValue();
+    LOG_DEBUG("WebServer", "DAC state requested: %d", value);
+    request.send(200, "text/plain", String(value));
+}
+
+void WebServerManager::handleDACStats(HttpRequest &request)
+{
+    JsonDocument doc;
+    dacControl->populateSetpointStats(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleDACVoltage(HttpRequest &request)
+{
+    if (request.hasArg("v"))
+    {
+        takeDacOutput();
+        if (!dacControl->setVoltage(request.arg("v").toFloat()))
+        {
+            sendError(request, 400, "Voltage outside calibrated range");
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    doc["value"] = dacControl->getValue();
+    doc["voltage"] = round(dacControl->getVoltage() * 1000.0) / 1000.0;
+    request.send(200, doc);
+}
+
+void WebServerManager::handleCalibration(HttpRequest &request)
 {
-    // Constructor body can be empty or have initialization code
+    JsonDocument doc;
+    dacControl->getCalibration().populateCalibration(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::begin()
+// Body: {"pointsMv":[...17 measured values...]} or {"reset":true}
+void WebServerManager::handleCalibrationSave(HttpRequest &request)
 {
-    // Set up all routes
-    server.on("/", HTTP_GET, [this]()
-              { this->handleRoot(); });
-    server.on("/style.css", HTTP_GET, [this]()
-              { this->handleCSS(); });
-
-    // JavaScript module routes
-    server.on("/controlModule.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/controlModule.js"); });
-    server.on("/scannerModule.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/scannerModule.js"); });
-    server.on("/sysInfoModule.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/sysInfoModule.js"); });
-    server.on("/tabModule.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/tabModule.js"); });
-    server.on("/main.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/main.js"); });
-    server.on("/api/ethernet/status", HTTP_GET, [this]()
-              { this->handleEthernetStatus(); });
-    server.on("/ethernet/config", HTTP_POST, [this]()
-              { this->handleEthernetConfig(); });
-    server.on("/ethernetModule.js", HTTP_GET, [this]()
-              { this->handleJavaScriptFile("/ethernetModule.js"); });
-
-    // API routes
-    server.on("/led", HTTP_GET, [this]()
-              { this->handleLED(); });
-    server.on("/ledstate", HTTP_GET, [this]()
-              { this->handleLEDState(); });
-    server.on("/dac", HTTP_GET, [this]()
-              { this->handleDAC(); });
-    server.on("/dacstate", HTTP_GET, [this]()
-              { this->handleDACState(); });
-    server.on("/clients", HTTP_GET, [this]()
-              { this->handleClients(); });
-    server.on("/sensor", HTTP_GET, [this]()
-              { this->handleSensor(); });
-    server.on("/scan", HTTP_GET, [this]()
-              { this->handleScan(); });
-    server.on("/sysinfo", HTTP_GET, [this]()
-              { this->handleSystemInfo(); });
-    server.on("/debug", HTTP_GET, [this]()
-              { this->handleDebug(); });
-
-    // Start the server
-    server.begin();
-    Serial.println("Web server started");
-}
-
-void WebServerManager::handleClient()
-{
-    server.handleClient();
-}
-
-// Helper function to serve files from SPIFFS
-void WebServerManager::serveFile(const String &path, const String &contentType)
+    JsonDocument doc;
+    if (!request.hasArg("plain") || deserializeJson(doc, request.arg("plain")))
+    {
+        sendFailure(request, 400, "Invalid JSON body");
+        return;
+    }
+
+    DacCalibration &calibration = dacControl->getCalibration();
+    if (doc["reset"] | false)
+    {
+        calibration.reset();
+    }
+    else
+    {
+        JsonArray points = doc["pointsMv"].as<JsonArray>();
+        if (points.size() != DAC_CALIBRATION_POINTS)
+        {
+            sendFailure(request, 400, "pointsMv needs one value per calibration code");
+            return;
+        }
+
+        uint16_t pointsMv[DAC_CALIBRATION_POINTS];
+        for (size_t i = 0; i < DAC_CALIBRATION_POINTS; i++)
+        {
+            // Checked before narrowing, or 65636 would wrap to a plausible 100
+            int32_t millivolts = points[i].is<int32_t>() ? points[i].as<int32_t>() : -1;
+            if (millivolts < 0 || millivolts > DAC_CALIBRATION_MAX_MV)
+            {
+                sendFailure(request, 400, "pointsMv must be integers from 0 to " + String(DAC_CALIBRATION_MAX_MV));
+                return;
+            }
+            pointsMv[i] = millivolts;
+        }
+
+        if (!calibration.save(pointsMv))
+        {
+            sendFailure(request, 400, "Points must be ascending and within range");
+            return;
+        }
+    }
+    calibration.populateCalibration(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+// /dac/loop?enable=1&target=<V>[&rate=<Hz>][&kp=<Q16>][&ki=<Q16>], /dac/loop?enable=0, or no args for status
+void WebServerManager::handleFeedbackLoop(HttpRequest &request)
 {
-    if (SPIFFS.exists(path))
+    if (request.hasArg("rate") && !feedbackLoop->setRate(request.arg("rate").toInt()))
     {
-        File file = SPIFFS.open(path, "r");
-        server.streamFile(file, contentType);
-        file.close();
+        sendError(request, 400, "rate must divide " + String(configTICK_RATE_HZ) + " Hz, up to " + String(FEEDBACK_MAX_RATE_HZ) + " Hz");
+        return;
+    }
+
+    if (request.hasArg("kp") || request.hasArg("ki"))
+    {
+        if (!feedbackLoop->setGains(request.hasArg("kp") ? request.arg("kp").toInt() : FEEDBACK_DEFAULT_KP,
+                                    request.hasArg("ki") ? request.arg("ki").toInt() : FEEDBACK_DEFAULT_KI))
+        {
+            sendError(request, 400, "kp and ki must be 0-" + String(FEEDBACK_MAX_GAIN) + " (Q16)");
+            return;
+        }
+    }
+
+    if (request.hasArg("enable"))
+    {
+        if (request.arg("enable") == "0")
+        {
+            feedbackLoop->disable();
+        }
+        else
+        {
+            // The loop trims a static level only, so nothing else may be driving the DAC
+            sequencePlayer->stop();
+            dacControl->disarmTrigger();
+            if (!request.hasArg("target") || !feedbackLoop->enable(request.arg("target").toFloat()))
+            {
+                sendError(request, 400, "target voltage missing or outside calibrated range");
+                return;
+            }
+        }
+    }
+
+    JsonDocument doc;
+    feedbackLoop->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleDACRamp(HttpRequest &request)
+{
+    // Without a target this only reports ramp progress
+    if (request.hasArg("target"))
+    {
+        int target = request.arg("target").toInt();
+        bool started;
+
+        takeDacOutput();
+        if (request.hasArg("slew"))
+        {
+            started = dacControl->startSlew(target, request.arg("slew").toFloat());
+        }
+        else if (request.hasArg("duration"))
+        {
+            started = dacControl->startRamp(target, request.arg("duration").toInt());
+        }
+        else
+        {
+            sendError(request, 400, "duration (ms) or slew (V/s) is required");
+            return;
+        }
+
+        if (!started)
+        {
+            sendError(request, 400, "Invalid ramp parameters");
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    dacControl->populateRamp(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+// POST /dac/stream (Content-Type: application/octet-stream). The body is read
+// chunk by chunk straight from the socket into the DAC ring buffer and never
+// collected into a String. Query: rate=<Hz>, format=u8|u16, mode=loop|oneshot
+// The route is self-locking: the socket is read without controlMutex, so a slow
+// client does not hold up loop(), and the lock is taken around each DAC call.
+void WebServerManager::handleStreamUpload(HttpRequest &request)
+{
+    uint32_t rate = request.hasArg("rate") ? request.arg("rate").toInt() : 8000;
+    String format = request.hasArg("format") ? request.arg("format") : "u8";
+    String mode = request.hasArg("mode") ? request.arg("mode") : "oneshot";
+    streamFormat16 = format == "u16";
+    streamHasCarry = false;
+    streamUploadStatus = 200;
+    streamUploadError = nullptr;
+
+    if (format != "u8" && format != "u16")
+    {
+        failStreamUpload(400, "format must be u8 or u16");
+    }
+    else if (mode != "loop" && mode != "oneshot")
+    {
+        failStreamUpload(400, "mode must be loop or oneshot");
     }
     else
     {
-        server.send(404, "text/plain", "File not found: " + path);
-        Serial.println("File not found: " + path);
+        xSemaphoreTake(controlMutex, portMAX_DELAY);
+        takeDacOutput();
+        bool begun = dacControl->beginStream(rate, mode == "loop");
+        xSemaphoreGive(controlMutex);
+        if (!begun)
+        {
+            failStreamUpload(400, "rate out of range");
+        }
+    }
+
+    uint8_t data[HTTP_CHUNK_SIZE];
+    size_t remaining = request.contentLength();
+    while (remaining > 0)
+    {
+        int length = request.receive(data, remaining < sizeof(data) ? remaining : sizeof(data));
+        if (length <= 0)
+        {
+            // Client went away mid-upload; the reply is unlikely to reach it
+            failStreamUpload(400, "Upload interrupted");
+            break;
+        }
+        remaining -= length;
+
+        if (streamUploadStatus != 200)
+        {
+            // Keep draining so the error response reaches the client
+            continue;
+        }
+
+        const uint8_t *samples = data;
+        size_t count = length;
+        uint8_t narrowed[HTTP_CHUNK_SIZE / 2 + 1];
+        if (streamFormat16)
+        {
+            // 16-bit little-endian samples scaled to 8 bits; a sample may straddle two chunks
+            samples = narrowed;
+            count = 0;
+            int i = 0;
+            if (streamHasCarry)
+            {
+                narrowed[count++] = data[0];
+                i = 1;
+                streamHasCarry = false;
+            }
+            for (; i + 1 < length; i += 2)
+            {
+                narrowed[count++] = data[i + 1];
+            }
+            if (i < length)
+            {
+                streamHasCarry = true;
+            }
+        }
+
+        xSemaphoreTake(controlMutex, portMAX_DELAY);
+        size_t written = dacControl->writeStream(samples, count);
+        bool receiving = dacControl->isStreamReceiving();
+        xSemaphoreGive(controlMutex);
+
+        if (!receiving)
+        {
+            failStreamUpload(409, "Stream was stopped by another output");
+        }
+        else if (written < count)
+        {
+            // A loop waveform has to fit the buffer; a one-shot only stalls if playback does
+            if (mode == "loop")
+            {
+                failStreamUpload(413, "Waveform does not fit the stream buffer");
+            }
+            else
+            {
+                failStreamUpload(503, "Playback did not drain the stream buffer in time");
+            }
+        }
     }
+
+    xSemaphoreTake(controlMutex, portMAX_DELAY);
+    handleStreamComplete(request);
+    xSemaphoreGive(controlMutex);
 }
 
-// Route handlers
-void WebServerManager::handleRoot()
+void WebServerManager::failStreamUpload(int status, const char *error)
 {
-    serveFile("/index.html", "text/html");
+    // The first failure is the one reported
+    if (streamUploadStatus == 200)
+    {
+        streamUploadStatus = status;
+        streamUploadError = error;
+    }
 }
 
-void WebServerManager::handleCSS()
+// Called with controlMutex held
+void WebServerManager::handleStreamComplete(HttpRequest &request)
 {
-    serveFile("/style.css", "text/css");
+    if (streamUploadStatus == 200 && !dacControl->isStreamReceiving())
+    {
+        failStreamUpload(409, "Stream was stopped by another output");
+    }
+    // Overflow is caught as it happens, so endStream() only refuses an empty upload here
+    if (streamUploadStatus == 200 && !dacControl->endStream())
+    {
+        failStreamUpload(400, "Empty upload");
+    }
+
+    if (streamUploadStatus != 200)
+    {
+        // Only stop the stream if it still owns the DAC
+        if (dacControl->isStreamReceiving())
+        {
+            dacControl->abortStream();
+        }
+        sendError(request, streamUploadStatus, streamUploadError);
+        return;
+    }
+    JsonDocument doc;
+    dacControl->populateStream(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleJavaScriptFile(const String &filename)
+void WebServerManager::handleStreamStatus(HttpRequest &request)
 {
-    serveFile(filename, "application/javascript");
+    JsonDocument doc;
+    dacControl->populateStream(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleLED()
+void WebServerManager::handleSequenceLoad(HttpRequest &request)
 {
-    String state;
-    if (server.hasArg("state"))
+    if (!request.hasArg("plain"))
     {
-        state = server.arg("state");
-        digitalWrite(LED_PIN, state.toInt());
-        Serial.print("[WebServer] LED state set to: ");
-        Serial.println(state);
+        sendFailure(request, 400, "Missing request body");
+        return;
+    }
+
+    String error;
+    if (!sequencePlayer->loadJSON(request.arg("plain"), error))
+    {
+        sendFailure(request, 400, error);
+        return;
     }
-    server.send(200, "text/plain", "LED state set to " + state);
+    JsonDocument doc;
+    sequencePlayer->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleLEDState()
+void WebServerManager::handleSequenceStatus(HttpRequest &request)
 {
-    String state = String(digitalRead(LED_PIN));
-    Serial.print("[WebServer] LED state requested: ");
-    Serial.println(state);
-    server.send(200, "text/plain", state);
+    JsonDocument doc;
+    sequencePlayer->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleDAC()
+void WebServerManager::handleSequenceStart(HttpRequest &request)
 {
-    if (server.hasArg("value"))
+    feedbackLoop->disable();
+    if (!sequencePlayer->start())
     {
-        int value = server.arg("value").toInt();
-        dacControl->setValue(value);
-        Serial.print("[WebServer] DAC value set to: ");
-        Serial.println(value);
+        sendFailure(request, 409, "No sequence loaded");
+        return;
     }
-    server.send(200, "text/plain", String(dacControl->getValue()));
+    JsonDocument doc;
+    sequencePlayer->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleDACState()
+void WebServerManager::handleSequenceStop(HttpRequest &request)
 {
-    int value = dacControl->getValue();
-    Serial.print("[WebServer] DAC state requested: ");
-    Serial.println(value);
-    server.send(200, "text/plain", String(value));
+    sequencePlayer->stop();
+    JsonDocument doc;
+    sequencePlayer->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+// /trigger?arm=1[&target=waveform|sequence][&edge=rising|falling|both][&rearm=1], /trigger?arm=0, or no args for status
+void WebServerManager::handleTrigger(HttpRequest &request)
+{
+    if (request.hasArg("arm"))
+    {
+        if (request.arg("arm") == "0")
+        {
+            dacControl->disarmTrigger();
+        }
+        else
+        {
+            String targetName = request.hasArg("target") ? request.arg("target") : "waveform";
+            String edgeName = request.hasArg("edge") ? request.arg("edge") : "rising";
+
+            int edge;
+            if (edgeName == "rising")
+                edge = RISING;
+            else if (edgeName == "falling")
+                edge = FALLING;
+            else if (edgeName == "both")
+                edge = CHANGE;
+            else
+            {
+                sendError(request, 400, "edge must be rising, falling or both");
+                return;
+            }
+
+            TriggerTarget target;
+            if (targetName == "waveform")
+                target = TriggerTarget::Waveform;
+            else if (targetName == "sequence")
+                target = TriggerTarget::Sequence;
+            else
+            {
+                sendError(request, 400, "target must be waveform or sequence");
+                return;
+            }
+
+            // The output is preloaded now so the ISR has nothing left to compute
+            takeDacOutput();
+            if (!dacControl->armTrigger(target, edge, request.arg("rearm") == "1"))
+            {
+                sendError(request, 409,
+                          target == TriggerTarget::Waveform ? "Start a table or DDS waveform before arming"
+                                                            : "Sequencer not available");
+                return;
+            }
+        }
+    }
+
+    JsonDocument doc;
+    dacControl->populateTrigger(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleWaveform(HttpRequest &request)
+{
+    // Without parameters this just reports the current generator state
+    if (request.hasArg("shape") || request.hasArg("freq"))
+    {
+        Waveform shape = Waveform::Sine;
+        if (request.hasArg("shape") && !DACControl::parseWaveform(request.arg("shape"), shape))
+        {
+            sendError(request, 400, "Unknown waveform shape");
+            return;
+        }
+
+        float frequency = request.hasArg("freq") ? request.arg("freq").toFloat() : 1000.0;
+        int amplitude = request.hasArg("amplitude") ? request.arg("amplitude").toInt() : 127;
+        int offset = request.hasArg("offset") ? request.arg("offset").toInt() : 128;
+
+        takeDacOutput();
+        if (!dacControl->startWaveform(shape, frequency, constrain(amplitude, 0, 128), constrain(offset, 0, 255)))
+        {
+            sendError(request, 400, "Frequency out of range");
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    dacControl->populateWaveform(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleWaveformStop(HttpRequest &request)
+{
+    dacControl->stopWaveform();
+    JsonDocument doc;
+    dacControl->populateWaveform(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+// Both DAC channels as one generator:
+// /generator?shape=&freq=&amplitude=&offset=&pairing=none|quadrature|differential|phase&phase=<deg>
+void WebServerManager::handleGenerator(HttpRequest &request)
+{
+    if (request.hasArg("shape") || request.hasArg("freq"))
+    {
+        GeneratorSettings settings;
+        settings.shape = Waveform::Sine;
+        if (request.hasArg("shape") && !DACControl::parseWaveform(request.arg("shape"), settings.shape))
+        {
+            sendError(request, 400, "Unknown waveform shape");
+            return;
+        }
+        if (!DACControl::parsePairing(request.arg("pairing"), settings.pairing))
+        {
+            sendError(request, 400, "Unknown channel pairing");
+            return;
+        }
+
+        settings.frequency = request.hasArg("freq") ? request.arg("freq").toFloat() : 1000.0;
+        settings.amplitude = constrain(request.hasArg("amplitude") ? request.arg("amplitude").toInt() : 127, 0, 128);
+        settings.offset = constrain(request.hasArg("offset") ? request.arg("offset").toInt() : 128, 0, 255);
+        settings.phaseDegrees = request.hasArg("phase") ? request.arg("phase").toFloat() : 0.0;
+
+        takeDacOutput();
+        if (!dacControl->startGenerator(settings))
+        {
+            sendError(request, 400, "Frequency out of range");
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    dacControl->populateWaveform(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleDDS(HttpRequest &request)
+{
+    bool ddsRunning = dacControl->getOutputMode() == DacOutputMode::Dds;
+
+    if (request.hasArg("freq") && ddsRunning && !request.hasArg("shape") &&
+        !request.hasArg("amplitude") && !request.hasArg("offset"))
+    {
+        // Only the frequency changed: retune in place, keeping the phase continuous
+        if (!dacControl->setFrequency(request.arg("freq").toFloat()))
+        {
+            sendError(request, 400, "Frequency out of range");
+            return;
+        }
+    }
+    else if (request.hasArg("shape") || request.hasArg("freq"))
+    {
+        Waveform shape = Waveform::Sine;
+        if (request.hasArg("shape") && !DACControl::parseWaveform(request.arg("shape"), shape))
+        {
+            sendError(request, 400, "Unknown waveform shape");
+            return;
+        }
+
+        float frequency = request.hasArg("freq") ? request.arg("freq").toFloat() : 1000.0;
+        int amplitude = request.hasArg("amplitude") ? request.arg("amplitude").toInt() : 127;
+        int offset = request.hasArg("offset") ? request.arg("offset").toInt() : 128;
+
+        takeDacOutput();
+        if (!dacControl->startDDS(shape, frequency, constrain(amplitude, 0, 128), constrain(offset, 0, 255)))
+        {
+            sendError(request, 400, "Frequency out of range");
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    dacControl->populateWaveform(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleSweep(HttpRequest &request)
+{
+    if (!request.hasArg("start") || !request.hasArg("end") || !request.hasArg("duration"))
+    {
+        sendError(request, 400, "start, end and duration are required");
+        return;
+    }
+
+    dds::SweepMode mode = request.arg("mode") == "log" ? dds::SweepMode::Logarithmic : dds::SweepMode::Linear;
+    float start = request.arg("start").toFloat();
+    takeDacOutput();
+
+    // A shape switches the generator over before sweeping, otherwise the current settings are kept
+    if (request.hasArg("shape"))
+    {
+        Waveform shape = Waveform::Sine;
+        if (!DACControl::parseWaveform(request.arg("shape"), shape))
+        {
+            sendError(request, 400, "Unknown waveform shape");
+            return;
+        }
+
+        int amplitude = request.hasArg("amplitude") ? request.arg("amplitude").toInt() : 127;
+        int offset = request.hasArg("offset") ? request.arg("offset").toInt() : 128;
+        if (!dacControl->startDDS(shape, start, constrain(amplitude, 0, 128), constrain(offset, 0, 255)))
+        {
+            sendError(request, 400, "Frequency out of range");
+            return;
+        }
+    }
+
+    if (!dacControl->startSweep(start, request.arg("end").toFloat(), request.arg("duration").toInt(), mode))
+    {
+        sendError(request, 400, "Invalid sweep parameters");
+        return;
+    }
+
+    JsonDocument doc;
+    dacControl->populateWaveform(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleClients()
+void WebServerManager::handleClients(HttpRequest &request)
 {
     int clients = WiFi.softAPgetStationNum();
-    Serial.print("[WebServer] Client count requested: ");
-    Serial.println(clients);
-    server.send(200, "text/plain", String(clients));
+    LOG_DEBUG("WebServer", "Client count requested: %d", clients);
+    request.send(200, "text/plain", String(clients));
+}
+
+void WebServerManager::handleSensor(HttpRequest &request)
+{
+    // Built as a document so binary clients get it without a JSON round trip;
+    // a sensor that is not ready reports null rather than nan
+    JsonDocument doc;
+    doc["ready"] = dhtSensor->isReady();
+    doc["temperature"] = dhtSensor->getTemperature();
+    doc["humidity"] = dhtSensor->getHumidity();
+
+    LOG_DEBUG("WebServer", "Sensor data requested: ready=%d temperature=%.1f humidity=%.1f", dhtSensor->isReady(),
+              dhtSensor->getTemperature(), dhtSensor->getHumidity());
+
+    request.send(200, doc);
+}
+
+// /scan[?clock=<Hz>][&identify=0]: starts a background scan and answers right away with
+// its status; poll /scan/status for progress and results. 409 while a scan is still running.
+// identify=0 skips the ID register reads and names devices by address alone.
+void WebServerManager::handleScan(HttpRequest &request)
+{
+    uint32_t clock = I2C_SCAN_DEFAULT_CLOCK;
+    if (request.hasArg("clock"))
+    {
+        clock = strtoul(request.arg("clock").c_str(), nullptr, 10);
+        if (clock < I2C_SCAN_MIN_CLOCK || clock > I2C_SCAN_MAX_CLOCK)
+        {
+            sendError(request, 400, "clock must be " + String(I2C_SCAN_MIN_CLOCK) + "-" + String(I2C_SCAN_MAX_CLOCK) + " Hz");
+            return;
+        }
+    }
+
+    bool identify = !request.hasArg("identify") || request.arg("identify") != "0";
+    bool started = i2cScanner->startScan(clock, identify);
+    LOG_DEBUG("WebServer", "Scan request received, %s", started ? "started" : "already running");
+    JsonDocument doc;
+    i2cScanner->populateStatus(doc.to<JsonObject>());
+    request.send(started ? 202 : 409, doc);
+}
+
+void WebServerManager::handleScanStatus(HttpRequest &request)
+{
+    JsonDocument doc;
+    i2cScanner->populateStatus(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleSensor()
+// Arbiter statistics: how often and how long clients waited for the bus
+void WebServerManager::handleI2CBus(HttpRequest &request)
 {
-    // Create a JSON response with sensor data
-    String sensorJson = "{";
-    sensorJson += "\"ready\":" + String(dhtSensor->isReady() ? "true" : "false") + ",";
-    sensorJson += "\"temperature\":" + String(dhtSensor->getTemperature()) + ",";
-    sensorJson += "\"humidity\":" + String(dhtSensor->getHumidity());
-    sensorJson += "}";
+    JsonDocument doc;
+    i2cBus->populateStats(doc.to<JsonObject>());
+    request.send(200, doc);
+}
+
+void WebServerManager::handleSystemInfo(HttpRequest &request)
+{
+    LOG_DEBUG("WebServer", "System Info requested");
 
-    Serial.print("[WebServer] Sensor data requested: ");
-    Serial.println(sensorJson);
+    // Get system info from the SystemInfo class
+    JsonDocument doc;
+    JsonObject root = doc.to<JsonObject>();
+    systemInfo->populateSystemInfo(root);
 
-    server.send(200, "application/json", sensorJson);
+    // Send the response in whichever encoding the client accepts
+    request.send(200, doc);
 }
 
-void WebServerManager::handleScan()
+// /events[?interval=<ms>]: long-lived text/event-stream of system info and sensor snapshots
+void WebServerManager::handleEvents(HttpRequest &request)
 {
-    Serial.println("[WebServer] Scan request received");
+    uint32_t interval = request.hasArg("interval") ? request.arg("interval").toInt() : SSE_DEFAULT_INTERVAL;
+    interval = constrain(interval, SSE_MIN_INTERVAL, SSE_MAX_INTERVAL);
+
+    if (subscriberCount >= SSE_MAX_SUBSCRIBERS)
+    {
+        sendError(request, 503, "Too many event subscribers");
+        return;
+    }
 
-    // Perform the scan directly
-    i2cScanner->scan();
+    if (!request.beginEventStream())
+    {
+        return;
+    }
 
-    // Get and return results
-    String results = i2cScanner->getJSONResults();
-    Serial.print("[WebServer] Scan results: ");
-    Serial.println(results);
+    // The first snapshot goes out with the next tick
+    EventSubscriber &subscriber = subscribers[subscriberCount];
+    subscriber.socket = request.socket();
+    subscriber.intervalMs = interval;
+    subscriber.nextDue = millis();
+    subscriberCount++;
 
-    server.send(200, "application/json", results);
+    LOG_INFO("WebServer", "Event subscriber on socket %d every %u ms", subscriber.socket, interval);
 }
 
-void WebServerManager::handleSystemInfo()
+// /api/state[?fields=sensor,clients,led,dac,battery][&since=<version>]: the whole dashboard
+// in one document. With since, only groups changed after that version are included,
+// and 304 means none of the requested ones did.
+void WebServerManager::handleApiState(HttpRequest &request)
 {
-    Serial.println("System Info requested");
+    uint32_t fields = STATE_ALL;
+    if (request.hasArg("fields") && !LiveState::parseFields(request.arg("fields"), fields))
+    {
+        sendError(request, 400, "fields: sensor, clients, led, dac, battery");
+        return;
+    }
+
+    liveState->refresh();
+    if (request.hasArg("since"))
+    {
+        fields &= liveState->changedSince(strtoul(request.arg("since").c_str(), nullptr, 10));
+        if (fields == 0)
+        {
+            // Same Vary as the 200 it stands in for
+            request.sendHeader("Vary", "Accept");
+            request.send(304, HttpRequest::contentType(request.acceptedEncoding()), String());
+            return;
+        }
+    }
+
+    JsonDocument doc;
+    stateDocument(doc, fields);
+    request.send(200, doc);
+}
 
-    // Get system info JSON from the SystemInfo class
-    String jsonResponse = systemInfo->getCompleteSystemInfoJSON();
+// /api/sensors: the latest snapshot from the I2C sensor drivers; never waits on the bus
+void WebServerManager::handleApiSensors(HttpRequest &request)
+{
+    JsonDocument doc;
+    JsonArray sensors = doc["sensors"].to<JsonArray>();
+    sensorScheduler->populateSensors(sensors);
+    request.send(200, doc);
+}
 
-    // Send the response
-    server.send(200, "application/json", jsonResponse);
+// /log[?level=error|warn|info|debug]: logger statistics, and the level changed at runtime
+void WebServerManager::handleLog(HttpRequest &request)
+{
+    if (request.hasArg("level"))
+    {
+        LogLevel level;
+        if (!Logger::parseLevel(request.arg("level"), level))
+        {
+            sendError(request, 400, "level must be error, warn, info or debug");
+            return;
+        }
+        logger.setLevel(level);
+        LOG_INFO("WebServer", "Log level set to %s", Logger::levelName(level));
+    }
+    JsonDocument doc;
+    logger.populateStats(doc.to<JsonObject>());
+    request.send(200, doc);
 }
 
-void WebServerManager::handleEthernetStatus()
+void WebServerManager::handleEthernetStatus(HttpRequest &request)
 {
-    Serial.println("[WebServer] Ethernet status requested");
+    LOG_DEBUG("WebServer", "Ethernet status requested");
 
     if (ethernetController != nullptr)
     {
-        String statusJson = ethernetController->getStatusJSON();
-        Serial.print("[WebServer] Ethernet status: ");
-        Serial.println(statusJson);
+        JsonDocument doc;
+        ethernetController->populateStatus(doc.to<JsonObject>());
+        LOG_DEBUG("WebServer", "Ethernet status: connected=%d", doc["connected"].as<bool>());
 
-        server.send(200, "application/json", statusJson);
+        request.send(200, doc);
     }
     else
     {
-        server.send(503, "application/json", "{\"error\":\"Ethernet controller not available\"}");
+        sendError(request, 503, "Ethernet controller not available");
     }
 }
 
-void WebServerManager::handleEthernetConfig()
+void WebServerManager::handleEthernetConfig(HttpRequest &request)
 {
-    Serial.println("[WebServer] Ethernet configuration update requested");
+    LOG_INFO("WebServer", "Ethernet configuration update requested");
 
     if (ethernetController == nullptr)
     {
-        server.send(503, "application/json", "{\"success\":false,\"error\":\"Ethernet controller not available\"}");
+        sendFailure(request, 503, "Ethernet controller not available");
         return;
     }
 
-    if (server.hasArg("plain"))
+    if (request.hasArg("plain"))
     {
-        String body = server.arg("plain");
+        String body = request.arg("plain");
         DynamicJsonDocument doc(512);
         DeserializationError error = deserializeJson(doc, body);
 
         if (error)
         {
-            String errorMsg = "{\"success\":false,\"error\":\"JSON parsing failed: ";
-            errorMsg += error.c_str();
-            errorMsg += "\"}";
-            server.send(400, "application/json", errorMsg);
+            sendFailure(request, 400, String("JSON parsing failed: ") + error.c_str());
             return;
         }
 
@@ -283,28 +1620,31 @@ void WebServerManager::handleEthernetConfig()
 
         if (!valid)
         {
-            server.send(400, "application/json", "{\"success\":false,\"error\":\"Invalid IP address format\"}");
+            sendFailure(request, 400, "Invalid IP address format");
             return;
         }
 
         // Update configuration
         if (ethernetController->updateConfig(newIp, newGateway, newSubnet, newDns))
         {
-            server.send(200, "application/json", "{\"success\":true,\"message\":\"Configuration saved. Please restart the device for changes to take effect.\"}");
+            JsonDocument response;
+            response["success"] = true;
+            response["message"] = "Configuration saved. Please restart the device for changes to take effect.";
+            request.send(200, response);
         }
         else
         {
-            server.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to save configuration\"}");
+            sendFailure(request, 500, "Failed to save configuration");
         }
     }
     else
     {
-        server.send(400, "application/json", "{\"success\":false,\"error\":\"Missing request body\"}");
+        sendFailure(request, 400, "Missing request body");
     }
 }
 
 // Also modify the debug handler to include Ethernet routes
-void WebServerManager::handleDebug()
+void WebServerManager::handleDebug(HttpRequest &request)
 {
     String output = "<html><body><h1>SPIFFS Debug Info</h1>";
 
@@ -320,27 +1660,21 @@ void WebServerManager::handleDebug()
     }
     output += "</ul>";
 
-    // List registered server routes
+    output += "<p>Gzipped assets in manifest: " + String(staticAssets.count()) + "</p>";
+    output += "<p>Connections: " + String(connectionsOpened) + " opened, " + String(requestsServed) +
+              " requests, " + String(idleClosed) + " closed idle, " + String(limitClosed) + " closed at the request limit</p>";
+
+    // List registered server routes, straight from the table dispatch uses
     output += "<h2>Web Server Routes:</h2><ul>";
-    output += "<li>/</li>";
-    output += "<li>/style.css</li>";
-    output += "<li>/led</li>";
-    output += "<li>/ledstate</li>";
-    output += "<li>/dac</li>";
-    output += "<li>/dacstate</li>";
-    output += "<li>/clients</li>";
-    output += "<li>/sensor</li>";
-    output += "<li>/scan</li>";
-    output += "<li>/sysinfo</li>";
-    output += "<li>/debug</li>";
-    output += "<li>/controlModule.js</li>";
-    output += "<li>/scannerModule.js</li>";
-    output += "<li>/sysInfoModule.js</li>";
-    output += "<li>/tabModule.js</li>";
-    output += "<li>/main.js</li>";
-    output += "<li>/ethernetModule.js</li>";   // Add this new route
-    output += "<li>/api/ethernet/status</li>"; // Add this new route
-    output += "<li>/ethernet/config</li>";     // Add this new route
+    RouteTable table = routeTable();
+    for (size_t i = 0; i < table.count; i++)
+    {
+        const Route &route = table.routes[i];
+        output += "<li>" + String(http_method_str(route.method)) + " " + route.path + " (" + route.contentType + ")</li>";
+    }
+#if CONFIG_HTTPD_WS_SUPPORT
+    output += "<li>GET /ws (WebSocket)</li>";
+#endif
     output += "</ul>";
 
     // Also add Ethernet status to the debug info
@@ -368,5 +1702,5 @@ void WebServerManager::handleDebug()
 
     output += "</body></html>";
 
-    server.send(200, "text/html", output);
+    request.send(200, "text/html", output);
 }
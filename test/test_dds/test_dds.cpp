@@ -0,0 +1,165 @@
+// Host tests and a rough benchmark for the DDS kernel in include/dds.h.
+// Run with: pio test -e native
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "dds.h"
+
+static const uint32_t SAMPLE_RATE = 40000; // DAC_DDS_SAMPLE_RATE
+
+void setUp() {}
+void tearDown() {}
+
+static double frequencyOf(const dds::Oscillator &osc)
+{
+    return dds::frequencyForIncrement(osc.increment, SAMPLE_RATE);
+}
+
+static void run(dds::Oscillator &osc, uint32_t samples)
+{
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        dds::step(osc);
+    }
+}
+
+void test_increment_round_trip()
+{
+    uint64_t increment = dds::incrementForFrequency(1000.25, SAMPLE_RATE);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 1000.25, dds::frequencyForIncrement(increment, SAMPLE_RATE));
+}
+
+void test_min_frequency_advances_phase()
+{
+    dds::Oscillator osc;
+    dds::reset(osc, dds::incrementForFrequency(dds::minFrequency(SAMPLE_RATE), SAMPLE_RATE));
+    run(osc, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, osc.phase);
+
+    // Half an LSB rounds to zero and would never move
+    TEST_ASSERT_EQUAL_UINT64(0, dds::incrementForFrequency(dds::minFrequency(SAMPLE_RATE) / 4, SAMPLE_RATE) >> 32);
+}
+
+void test_linear_sweep_endpoints()
+{
+    uint64_t start = dds::incrementForFrequency(100.0, SAMPLE_RATE);
+    uint64_t end = dds::incrementForFrequency(10000.0, SAMPLE_RATE);
+    uint32_t samples = SAMPLE_RATE; // One second
+
+    dds::Oscillator osc;
+    dds::reset(osc, 0);
+    dds::startLinearSweep(osc, start, end, samples);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 100.0, frequencyOf(osc));
+
+    run(osc, samples / 2);
+    TEST_ASSERT_DOUBLE_WITHIN(0.5, 5050.0, frequencyOf(osc));
+
+    run(osc, samples / 2);
+    TEST_ASSERT_TRUE(osc.sweepMode == dds::SweepMode::None);
+    TEST_ASSERT_EQUAL_UINT64(end, osc.increment);
+}
+
+void test_linear_sweep_down()
+{
+    uint64_t start = dds::incrementForFrequency(5000.0, SAMPLE_RATE);
+    uint64_t end = dds::incrementForFrequency(50.0, SAMPLE_RATE);
+
+    dds::Oscillator osc;
+    dds::reset(osc, 0);
+    dds::startLinearSweep(osc, start, end, 4000);
+    run(osc, 4000);
+    TEST_ASSERT_EQUAL_UINT64(end, osc.increment);
+}
+
+void test_log_sweep_endpoints()
+{
+    uint64_t start = dds::incrementForFrequency(20.0, SAMPLE_RATE);
+    uint64_t end = dds::incrementForFrequency(20000.0, SAMPLE_RATE);
+    uint32_t samples = 2 * SAMPLE_RATE;
+
+    dds::Oscillator osc;
+    dds::reset(osc, 0);
+    dds::startLogSweep(osc, start, end, samples, dds::logSweepRatio(start, end, samples));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-6, 20.0, frequencyOf(osc));
+
+    // Halfway in time is the geometric mean in frequency
+    run(osc, samples / 2);
+    TEST_ASSERT_DOUBLE_WITHIN(632.46 * 0.01, 632.46, frequencyOf(osc));
+
+    // The last sample before the snap to the end point is already close to it
+    run(osc, samples / 2 - 1);
+    TEST_ASSERT_DOUBLE_WITHIN(20000.0 * 0.01, 20000.0, frequencyOf(osc));
+
+    run(osc, 1);
+    TEST_ASSERT_TRUE(osc.sweepMode == dds::SweepMode::None);
+    TEST_ASSERT_EQUAL_UINT64(end, osc.increment);
+}
+
+void test_log_sweep_down()
+{
+    uint64_t start = dds::incrementForFrequency(10000.0, SAMPLE_RATE);
+    uint64_t end = dds::incrementForFrequency(10.0, SAMPLE_RATE);
+    uint32_t samples = SAMPLE_RATE;
+
+    dds::Oscillator osc;
+    dds::reset(osc, 0);
+    dds::startLogSweep(osc, start, end, samples, dds::logSweepRatio(start, end, samples));
+    run(osc, samples - 1);
+    TEST_ASSERT_DOUBLE_WITHIN(10.0 * 0.01, 10.0, frequencyOf(osc));
+    run(osc, 1);
+    TEST_ASSERT_EQUAL_UINT64(end, osc.increment);
+}
+
+void test_log_sweep_ratio_rejects_zero_increment()
+{
+    TEST_ASSERT_EQUAL_UINT32(1UL << 30, dds::logSweepRatio(0, 1ULL << 40, 1000));
+}
+
+// Not a pass/fail test: reports host nanoseconds per sample for each mode
+void test_benchmark_step()
+{
+    static const uint32_t SAMPLES = 10000000;
+    const char *names[] = {"fixed", "linear sweep", "log sweep"};
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        uint64_t start = dds::incrementForFrequency(20.0, SAMPLE_RATE);
+        uint64_t end = dds::incrementForFrequency(20000.0, SAMPLE_RATE);
+        dds::Oscillator osc;
+        dds::reset(osc, start);
+        if (mode == 1)
+        {
+            dds::startLinearSweep(osc, start, end, SAMPLES);
+        }
+        else if (mode == 2)
+        {
+            dds::startLogSweep(osc, start, end, SAMPLES, dds::logSweepRatio(start, end, SAMPLES));
+        }
+
+        uint32_t sink = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < SAMPLES; i++)
+        {
+            sink += dds::tableIndex(dds::step(osc), 8);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+
+        char message[96];
+        snprintf(message, sizeof(message), "%s: %.2f ns/sample (checksum %u)", names[mode], ns / SAMPLES, sink);
+        TEST_MESSAGE(message);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_increment_round_trip);
+    RUN_TEST(test_min_frequency_advances_phase);
+    RUN_TEST(test_linear_sweep_endpoints);
+    RUN_TEST(test_linear_sweep_down);
+    RUN_TEST(test_log_sweep_endpoints);
+    RUN_TEST(test_log_sweep_down);
+    RUN_TEST(test_log_sweep_ratio_rejects_zero_increment);
+    RUN_TEST(test_benchmark_step);
+    return UNITY_END();
+}